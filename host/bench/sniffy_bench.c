@@ -0,0 +1,453 @@
+// Microbenchmarks of the device list and capture kernels, printed as CSV:
+//   sniffy_bench [--baseline baseline.csv] [--threshold PCT] [--filter SUBSTRING]
+// With a baseline the run fails when any kernel is more than PCT percent slower than its baseline.
+// Baselines are specific to the machine and build, the "# build:" line of a baseline records the build
+// it was taken with and a comparison against another build is flagged.
+
+#include "traffic_gen.h"
+#include "host_stubs.h"
+#include "esp_timer.h"
+#include "deauth/deauth.h"
+#include "device_list/device_list.h"
+#include "channel_stats/channel_stats.h"
+#include "seq_tracker/seq_tracker.h"
+#include "capture_log/capture_log_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_REPEAT 5                  // best of BENCH_REPEAT runs is reported
+#define BENCH_WORK 2000000              // rough number of node visits per run
+#define BENCH_MAX_RESULTS 128
+#define BENCH_DEFAULT_THRESHOLD 25.0
+
+#ifndef SNIFFY_BENCH_BUILD
+#define SNIFFY_BENCH_BUILD "unknown"
+#endif
+
+typedef struct {
+    char name[48];
+    uint32_t size;
+    double ns_per_op;
+} bench_result_t;
+
+// Run of a kernel, returns the time per operation in ns
+typedef double (*bench_kernel_t)(uint32_t size, uint32_t param);
+
+static bench_result_t results[BENCH_MAX_RESULTS];
+static size_t result_count = 0;
+static const char *filter = NULL;
+static uint64_t rng = 0x9e3779b97f4a7c15ULL;
+
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t next_random(void){
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 0x2545f4914f6cdd1dULL;
+}
+
+// Distinct MAC address for index i
+static void bench_mac(uint32_t i, uint8_t *mac){
+    mac[0] = 0x02;
+    mac[1] = 0x42;
+    mac[2] = (uint8_t)(i >> 24);
+    mac[3] = (uint8_t)(i >> 16);
+    mac[4] = (uint8_t)(i >> 8);
+    mac[5] = (uint8_t)i;
+}
+
+// List holding MAC addresses first .. first + size - 1 with some activity
+static device_list_t *bench_list(uint32_t first, uint32_t size){
+    device_list_t *list = device_list_new(1);
+    uint8_t mac[6];
+    for (uint32_t i = 0; i < size; i++) {
+        bench_mac(first + i, mac);
+        device_list_update(mac, (int8_t)(-40 - (int)(next_random() % 50)), (int64_t)(next_random() % 1000000), NULL, list);
+    }
+    return list;
+}
+
+// Operations per run for kernels that visit the whole list
+static uint32_t bench_ops(uint32_t size){
+    uint32_t ops = BENCH_WORK / (size + 1);
+    return ops < 16 ? 16 : ops;
+}
+
+static void bench_run(const char *name, uint32_t size, uint32_t param, bench_kernel_t kernel){
+    if (filter != NULL && strstr(name, filter) == NULL) {
+        return;
+    }
+
+    double best = 0;
+    for (int i = 0; i < BENCH_REPEAT; i++) {
+        double ns = kernel(size, param);
+        if (i == 0 || ns < best) {
+            best = ns;
+        }
+    }
+
+    if (result_count < BENCH_MAX_RESULTS) {
+        bench_result_t *result = &results[result_count++];
+        snprintf(result->name, sizeof(result->name), "%s", name);
+        result->size = size;
+        result->ns_per_op = best;
+    }
+    printf("%s,%u,%.1f\n", name, size, best);
+    fflush(stdout);
+}
+
+// Device list kernels
+
+// Lookups where param percent of the MAC addresses are in the list
+static double bench_find(uint32_t size, uint32_t param){
+    device_list_t *list = bench_list(0, size);
+    uint32_t ops = bench_ops(size);
+    uint8_t mac[6];
+    volatile const device_node_t *sink = NULL;
+
+    double start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t index = (uint32_t)(next_random() % size);
+        bench_mac(next_random() % 100 < param ? index : size + index, mac);
+        sink = device_list_find(mac, list);
+    }
+    double ns = (now_ns() - start) / ops;
+
+    (void)sink;
+    device_list_destroy(list);
+    return ns;
+}
+
+// Additions where param percent of the MAC addresses are already in the list
+static double bench_add(uint32_t size, uint32_t param){
+    device_list_t *list = bench_list(0, size);
+    uint32_t ops = bench_ops(size);
+    uint8_t mac[6];
+    double ns = 0;
+
+    // new devices are removed again after each timed batch so the list keeps its size
+    for (uint32_t done = 0; done < ops; done += 16) {
+        uint32_t batch[16];
+        for (int i = 0; i < 16; i++) {
+            uint32_t index = (uint32_t)(next_random() % size);
+            batch[i] = next_random() % 100 < param ? index : size + done + (uint32_t)i;
+        }
+        double start = now_ns();
+        for (int i = 0; i < 16; i++) {
+            bench_mac(batch[i], mac);
+            device_list_add(mac, list);
+        }
+        ns += now_ns() - start;
+        for (int i = 0; i < 16; i++) {
+            if (batch[i] >= size) {
+                bench_mac(batch[i], mac);
+                device_list_remove(mac, list);
+            }
+        }
+    }
+
+    device_list_destroy(list);
+    return ns / ops;
+}
+
+// Removals of devices in the list, added back after each timed batch
+static double bench_remove(uint32_t size, uint32_t param){
+    (void)param;
+    device_list_t *list = bench_list(0, size);
+    uint32_t ops = bench_ops(size);
+    uint8_t mac[6];
+    double ns = 0;
+
+    for (uint32_t done = 0; done < ops; done += 16) {
+        uint32_t batch[16];
+        for (int i = 0; i < 16; i++) {
+            batch[i] = (uint32_t)(next_random() % size);
+        }
+        double start = now_ns();
+        for (int i = 0; i < 16; i++) {
+            bench_mac(batch[i], mac);
+            device_list_remove(mac, list);
+        }
+        ns += now_ns() - start;
+        for (int i = 0; i < 16; i++) {
+            bench_mac(batch[i], mac);
+            device_list_add(mac, list);
+        }
+    }
+
+    device_list_destroy(list);
+    return ns / ops;
+}
+
+// Merge of three lists of size / 3 devices overlapping by half, per input device
+static double bench_combine(uint32_t size, uint32_t param){
+    (void)param;
+    uint32_t part = size / 3 ? size / 3 : 1;
+    device_list_t *list1 = bench_list(0, part);
+    device_list_t *list2 = bench_list(part / 2, part);
+    device_list_t *list3 = bench_list(part, part);
+
+    double start = now_ns();
+    device_list_t *combined = device_list_new_combine(list1, list2, list3, NULL);
+    double ns = (now_ns() - start) / (3 * part);
+
+    device_list_destroy(combined);
+    device_list_destroy(list1);
+    device_list_destroy(list2);
+    device_list_destroy(list3);
+    return ns;
+}
+
+// Export kernels
+
+// Full table walk with a cursor, per device
+static double bench_cursor_walk(uint32_t size, uint32_t param){
+    (void)param;
+    device_list_t *list = bench_list(0, size);
+    device_query_t query = { .min_rssi = -70 };
+    device_cursor_t cursor;
+    device_entry_t entries[64];
+    volatile size_t sink = 0;
+
+    double start = now_ns();
+    device_cursor_init(&cursor, &list, 1, &query);
+    size_t count;
+    while ((count = device_cursor_next_page(&cursor, entries, 64)) > 0) {
+        sink += count;
+    }
+    double ns = (now_ns() - start) / size;
+
+    (void)sink;
+    device_list_destroy(list);
+    return ns;
+}
+
+// First page of 50 devices ordered by activity, per page
+static double bench_cursor_ordered(uint32_t size, uint32_t param){
+    (void)param;
+    device_list_t *list = bench_list(0, size);
+    device_query_t query = { .order = DEVICE_ORDER_ACTIVITY };
+    device_cursor_t cursor;
+    device_entry_t entries[50];
+    uint32_t ops = bench_ops(size);
+
+    double start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        device_cursor_init(&cursor, &list, 1, &query);
+        device_cursor_next_page(&cursor, entries, 50);
+        device_cursor_deinit(&cursor);
+    }
+    double ns = (now_ns() - start) / ops;
+
+    device_list_destroy(list);
+    return ns;
+}
+
+// Copy of every MAC address, per device
+static double bench_get_mac_addresses(uint32_t size, uint32_t param){
+    (void)param;
+    device_list_t *list = bench_list(0, size);
+    uint32_t buf_size = size * 6;
+    uint8_t *buf = malloc(buf_size);
+
+    double start = now_ns();
+    get_mac_addresses(list, buf, &buf_size);
+    double ns = (now_ns() - start) / size;
+
+    free(buf);
+    device_list_destroy(list);
+    return ns;
+}
+
+// Capture log encoding of device sightings, per record
+static double bench_log_encode(uint32_t size, uint32_t param){
+    (void)param;
+    uint8_t block[CAPTURE_LOG_BLOCK_SIZE];
+    capture_log_encoder_t encoder;
+    capture_log_record_t record = { .type = CAPTURE_LOG_SIGHTING, .channel = 6 };
+
+    capture_log_encoder_init(&encoder, block, sizeof(block));
+    double start = now_ns();
+    for (uint32_t i = 0; i < size; i++) {
+        bench_mac(i, record.mac_addr);
+        record.rssi = (int8_t)(-40 - (i & 31));
+        record.frame_count = i;
+        record.timestamp_ms = i * 7;
+        if (!capture_log_encode(&encoder, &record)) {
+            capture_log_encoder_init(&encoder, block, sizeof(block));
+            capture_log_encode(&encoder, &record);
+        }
+    }
+    return (now_ns() - start) / size;
+}
+
+// Capture kernels, driven by the traffic generator
+
+static traffic_gen_t *bench_traffic(uint32_t devices){
+    traffic_gen_config_t config = TRAFFIC_GEN_DEFAULT_CONFIG();
+    config.device_count = devices;
+    config.churn = 0;
+    return traffic_gen_new(&config);
+}
+
+// Empty the sniffer's tables between runs
+static void bench_reset_sniffer(void){
+    for (uint8_t channel = 1; channel <= 14; channel++) {
+        device_list_clear(get_device_list(channel));
+    }
+    seq_tracker_clear();
+    channel_stats_clear();
+}
+
+// Frame header parsing, duplicate detection and time series update, per frame
+static double bench_frame_parse(uint32_t size, uint32_t param){
+    (void)param;
+    traffic_gen_t *gen = bench_traffic(size);
+    uint32_t ops = 200000;
+    wifi_promiscuous_pkt_type_t type;
+    int64_t timestamp;
+    volatile uint32_t sink = 0;
+
+    seq_tracker_clear();
+    double ns = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        const wifi_promiscuous_pkt_t *pkt = traffic_gen_next(gen, &type, &timestamp);
+        double start = now_ns();
+        if (!seq_tracker_check(pkt->payload, pkt->rx_ctrl.sig_len)) {
+            uint32_t airtime = channel_stats_airtime_us(&pkt->rx_ctrl);
+            channel_stats_record(pkt->rx_ctrl.channel, pkt->rx_ctrl.rssi, airtime, 0, timestamp);
+            sink += airtime;
+        }
+        ns += now_ns() - start;
+    }
+
+    (void)sink;
+    traffic_gen_destroy(gen);
+    return ns / ops;
+}
+
+// Whole promiscuous callback once the tables hold about size devices, per frame
+static double bench_callback(uint32_t size, uint32_t param){
+    (void)param;
+    traffic_gen_t *gen = bench_traffic(size);
+    wifi_promiscuous_cb_t callback = host_promiscuous_rx_cb();
+    wifi_promiscuous_pkt_type_t type;
+    int64_t timestamp;
+
+    // warm up until the tables are filled, then time a fixed number of frames
+    bench_reset_sniffer();
+    for (uint32_t i = 0; i < 4 * size; i++) {
+        const wifi_promiscuous_pkt_t *pkt = traffic_gen_next(gen, &type, &timestamp);
+        host_set_time(timestamp);
+        callback((void *)pkt, type);
+    }
+    uint32_t ops = bench_ops(size);
+    double ns = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        const wifi_promiscuous_pkt_t *pkt = traffic_gen_next(gen, &type, &timestamp);
+        host_set_time(timestamp);
+        double start = now_ns();
+        callback((void *)pkt, type);
+        ns += now_ns() - start;
+    }
+
+    traffic_gen_destroy(gen);
+    return ns / ops;
+}
+
+// Compare the results against a baseline, returns the number of regressions
+static int bench_check(const char *path, double threshold){
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open baseline %s\n", path);
+        return -1;
+    }
+
+    int regressions = 0;
+    char line[128];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (strncmp(line, "# build: ", 9) == 0) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (strcmp(line + 9, SNIFFY_BENCH_BUILD) != 0) {
+                fprintf(stderr, "warning: baseline taken with build \"%s\", this is \"%s\"\n", line + 9, SNIFFY_BENCH_BUILD);
+            }
+            continue;
+        }
+        char name[48];
+        unsigned size;
+        double baseline;
+        if (sscanf(line, "%47[^,],%u,%lf", name, &size, &baseline) != 3) {
+            continue;
+        }
+        for (size_t i = 0; i < result_count; i++) {
+            if (strcmp(results[i].name, name) != 0 || results[i].size != size) {
+                continue;
+            }
+            double change = (results[i].ns_per_op - baseline) / baseline * 100.0;
+            if (change > threshold) {
+                fprintf(stderr, "REGRESSION %s/%u: %.1f ns, baseline %.1f ns (%+.0f%%)\n",
+                        name, size, results[i].ns_per_op, baseline, change);
+                regressions++;
+            }
+        }
+    }
+    fclose(file);
+    return regressions;
+}
+
+int main(int argc, char **argv){
+    const char *baseline = NULL;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--baseline baseline.csv] [--threshold PCT] [--filter SUBSTRING]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // start_sniffer() registers the promiscuous callback with the host stubs
+    start_sniffer(1);
+
+    static const uint32_t sizes[] = { 100, 1000, 10000 };
+    printf("# build: %s\n", SNIFFY_BENCH_BUILD);
+    printf("kernel,size,ns_per_op\n");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t size = sizes[i];
+        bench_run("device_list_find/hit0", size, 0, bench_find);
+        bench_run("device_list_find/hit50", size, 50, bench_find);
+        bench_run("device_list_find/hit100", size, 100, bench_find);
+        bench_run("device_list_add/new", size, 0, bench_add);
+        bench_run("device_list_add/existing", size, 100, bench_add);
+        bench_run("device_list_remove", size, 0, bench_remove);
+        bench_run("device_list_new_combine", size, 0, bench_combine);
+        bench_run("export/cursor_walk", size, 0, bench_cursor_walk);
+        bench_run("export/cursor_page_activity", size, 0, bench_cursor_ordered);
+        bench_run("export/get_mac_addresses", size, 0, bench_get_mac_addresses);
+        bench_run("export/capture_log_encode", size, 0, bench_log_encode);
+        bench_run("capture/frame_parse", size, 0, bench_frame_parse);
+        bench_run("capture/callback", size, 0, bench_callback);
+    }
+
+    if (baseline != NULL) {
+        int regressions = bench_check(baseline, threshold);
+        if (regressions != 0) {
+            fprintf(stderr, "%d kernels regressed by more than %.0f%%\n", regressions, threshold);
+            return 1;
+        }
+        fprintf(stderr, "No kernel regressed by more than %.0f%%\n", threshold);
+    }
+    return 0;
+}
@@ -0,0 +1,226 @@
+// Decode a dump of the capture log partition, e.g. read with
+//   esptool.py read_flash 0x110000 0xf0000 capturelog.bin
+// and print its records as CSV in time order:
+//   capture_log_reader capturelog.bin [--boot N] [--from MS] [--to MS] [--index]
+
+#include "capture_log_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Location of a block in the dump, in write order
+typedef struct {
+    uint32_t sequence;
+    uint16_t boot;
+    uint32_t base_ms;
+    uint32_t sector;
+    uint32_t offset;
+    uint16_t length;
+} block_index_t;
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t sector;
+} sector_order_t;
+
+static int compare_sectors(const void *a, const void *b){
+    const sector_order_t *sa = a;
+    const sector_order_t *sb = b;
+    return sa->sequence < sb->sequence ? -1 : sa->sequence > sb->sequence;
+}
+
+// Position of a block on the time line, blocks are written in time order within a boot
+static int compare_time(uint16_t boot_a, uint32_t ms_a, uint16_t boot_b, uint32_t ms_b){
+    if (boot_a != boot_b) {
+        return boot_a < boot_b ? -1 : 1;
+    }
+    return ms_a < ms_b ? -1 : ms_a > ms_b;
+}
+
+static uint8_t *read_file(const char *path, size_t *size){
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = length > 0 ? malloc((size_t)length) : NULL;
+    if (data != NULL && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data != NULL ? (size_t)length : 0;
+    return data;
+}
+
+// Build the block index of the dump, ordered by sector sequence and offset
+static block_index_t *build_index(const uint8_t *data, size_t size, size_t *block_count, size_t *bad_blocks){
+    size_t sector_count = size / CAPTURE_LOG_SECTOR_SIZE;
+    sector_order_t *sectors = malloc(sector_count * sizeof(sector_order_t));
+    size_t valid = 0;
+    for (size_t i = 0; i < sector_count; i++) {
+        capture_log_sector_header_t header;
+        memcpy(&header, data + i * CAPTURE_LOG_SECTOR_SIZE, sizeof(header));
+        if (header.magic == CAPTURE_LOG_MAGIC && header.version == CAPTURE_LOG_VERSION) {
+            sectors[valid].sequence = header.sequence;
+            sectors[valid].sector = (uint32_t)i;
+            valid++;
+        }
+    }
+    qsort(sectors, valid, sizeof(sector_order_t), compare_sectors);
+
+    size_t capacity = 64;
+    size_t count = 0;
+    block_index_t *index = malloc(capacity * sizeof(block_index_t));
+    *bad_blocks = 0;
+    for (size_t i = 0; i < valid; i++) {
+        const uint8_t *sector = data + (size_t)sectors[i].sector * CAPTURE_LOG_SECTOR_SIZE;
+        capture_log_sector_header_t sector_header;
+        memcpy(&sector_header, sector, sizeof(sector_header));
+
+        uint32_t offset = sizeof(capture_log_sector_header_t);
+        while (offset + sizeof(capture_log_block_header_t) <= CAPTURE_LOG_SECTOR_SIZE) {
+            capture_log_block_header_t header;
+            memcpy(&header, sector + offset, sizeof(header));
+            if (header.length == CAPTURE_LOG_BLOCK_UNWRITTEN) {
+                break;
+            }
+            uint32_t payload = offset + sizeof(header);
+            if (header.length > CAPTURE_LOG_BLOCK_SIZE || payload + header.length > CAPTURE_LOG_SECTOR_SIZE) {
+                (*bad_blocks)++;
+                break;
+            }
+            if (capture_log_crc16(sector + payload, header.length) != header.crc) {
+                (*bad_blocks)++;
+            } else {
+                if (count == capacity) {
+                    capacity *= 2;
+                    index = realloc(index, capacity * sizeof(block_index_t));
+                }
+                index[count++] = (block_index_t){
+                    .sequence = sector_header.sequence,
+                    .boot = sector_header.boot,
+                    .base_ms = header.base_ms,
+                    .sector = sectors[i].sector,
+                    .offset = payload,
+                    .length = header.length
+                };
+            }
+            offset = (payload + header.length + 3) & ~3u;
+        }
+    }
+
+    free(sectors);
+    *block_count = count;
+    return index;
+}
+
+// First block that may hold records at or after (boot, from_ms)
+static size_t find_first_block(const block_index_t *index, size_t count, uint16_t boot, uint32_t from_ms){
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (compare_time(index[mid].boot, index[mid].base_ms, boot, from_ms) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    // the block before may still run past from_ms
+    return low > 0 ? low - 1 : 0;
+}
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s <dump.bin> [--boot N] [--from MS] [--to MS] [--index]\n", name);
+}
+
+int main(int argc, char **argv){
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    long boot = -1;
+    uint32_t from_ms = 0;
+    uint32_t to_ms = UINT32_MAX;
+    int print_index = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--index") == 0) {
+            print_index = 1;
+        } else if (strcmp(argv[i], "--boot") == 0 && i + 1 < argc) {
+            boot = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            from_ms = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            to_ms = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    size_t size;
+    uint8_t *data = read_file(argv[1], &size);
+    if (data == NULL) {
+        fprintf(stderr, "Failed to read %s\n", argv[1]);
+        return 1;
+    }
+
+    size_t block_count;
+    size_t bad_blocks;
+    block_index_t *index = build_index(data, size, &block_count, &bad_blocks);
+
+    if (print_index) {
+        printf("sequence,boot,sector,offset,base_ms,length\n");
+        for (size_t i = 0; i < block_count; i++) {
+            printf("%u,%u,%u,%u,%u,%u\n", index[i].sequence, index[i].boot, index[i].sector,
+                   index[i].offset, index[i].base_ms, index[i].length);
+        }
+    } else {
+        // without --boot the time range applies to every boot
+        size_t first = boot >= 0 ? find_first_block(index, block_count, (uint16_t)boot, from_ms) : 0;
+        size_t records = 0;
+        size_t encoded = 0;
+        printf("boot,timestamp_ms,type,channel,mac,rssi,frame_count,frame_control,length\n");
+        for (size_t i = first; i < block_count; i++) {
+            if (boot >= 0 && index[i].boot != boot) {
+                if (index[i].boot > boot) {
+                    break;
+                }
+                continue;
+            }
+
+            capture_log_decoder_t decoder;
+            capture_log_record_t record;
+            int ret;
+            capture_log_decoder_init(&decoder, data + (size_t)index[i].sector * CAPTURE_LOG_SECTOR_SIZE + index[i].offset,
+                                     index[i].length, index[i].base_ms);
+            while ((ret = capture_log_decode(&decoder, &record)) == 1) {
+                records++;
+                if (record.timestamp_ms < from_ms || record.timestamp_ms > to_ms) {
+                    continue;
+                }
+                printf("%u,%u,%s,%u,%02x:%02x:%02x:%02x:%02x:%02x,%d,%u,%u,%u\n",
+                       index[i].boot, record.timestamp_ms,
+                       record.type == CAPTURE_LOG_FRAME ? "frame" : "sighting", record.channel,
+                       record.mac_addr[0], record.mac_addr[1], record.mac_addr[2],
+                       record.mac_addr[3], record.mac_addr[4], record.mac_addr[5],
+                       record.rssi, record.frame_count, record.frame_control, record.length);
+            }
+            if (ret < 0) {
+                bad_blocks++;
+            }
+            encoded += index[i].length + sizeof(capture_log_block_header_t);
+        }
+        fprintf(stderr, "%zu records decoded from %zu bytes (%.1f bytes/record)\n",
+                records, encoded, records ? (double)encoded / (double)records : 0.0);
+    }
+    fprintf(stderr, "%zu blocks indexed, %zu bad blocks\n", block_count, bad_blocks);
+
+    free(index);
+    free(data);
+    return 0;
+}
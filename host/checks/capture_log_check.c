@@ -0,0 +1,239 @@
+// Round trip of the capture log codec and wraparound, resume and flash errors of the sector ring,
+// exits non-zero on failure
+//
+// The writer task never runs on the host, so capture_log.c is built into this check and its
+// block writer is driven directly.
+
+#include "capture_log/capture_log.c"
+#include "host_stubs.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK_SECTORS 4
+#define CHECK_RECORDS 3000
+
+static int failures = 0;
+static uint32_t rng = 1;
+
+static uint32_t next_random(void){
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+static void expect(const char *name, bool ok){
+    printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok) {
+        failures++;
+    }
+}
+
+// Record number i of a reproducible stream, timestamps increase
+static void make_record(uint32_t i, capture_log_record_t *record){
+    memset(record, 0, sizeof(*record));
+    record->type = next_random() % 3 == 0 ? CAPTURE_LOG_FRAME : CAPTURE_LOG_SIGHTING;
+    record->channel = (uint8_t)(1 + next_random() % 13);
+    record->rssi = (int8_t)(-20 - (int)(next_random() % 80));
+    record->timestamp_ms = 1000 + i * 7 + next_random() % 5;
+    for (int k = 0; k < 6; k++) {
+        record->mac_addr[k] = (uint8_t)(next_random() % 4 == 0 ? next_random() : (uint32_t)k);
+    }
+    if (record->type == CAPTURE_LOG_FRAME) {
+        record->frame_control = (uint8_t)next_random();
+        record->length = (uint16_t)(next_random() % 2400);
+    } else {
+        record->frame_count = next_random() % 100000;
+    }
+}
+
+static bool same_record(const capture_log_record_t *a, const capture_log_record_t *b){
+    if (a->type != b->type || a->channel != b->channel || a->rssi != b->rssi ||
+        a->timestamp_ms != b->timestamp_ms || memcmp(a->mac_addr, b->mac_addr, 6) != 0) {
+        return false;
+    }
+    if (a->type == CAPTURE_LOG_FRAME) {
+        return a->frame_control == b->frame_control && a->length == b->length;
+    }
+    return a->frame_count == b->frame_count;
+}
+
+// Encode a stream into blocks and decode every block back
+static void check_round_trip(void){
+    uint8_t buf[CAPTURE_LOG_BLOCK_SIZE];
+    capture_log_encoder_t enc;
+    capture_log_decoder_t dec;
+    capture_log_record_t in, out;
+    uint32_t i = 0, decoded = 0, blocks = 0;
+    bool ok = true;
+
+    rng = 1;
+    while (i < CHECK_RECORDS && ok) {
+        capture_log_encoder_init(&enc, buf, sizeof(buf));
+        uint32_t first = i;
+        uint32_t seed = rng;
+        while (i < CHECK_RECORDS) {
+            uint32_t before = rng;
+            make_record(i, &in);
+            if (!capture_log_encode(&enc, &in)) {
+                rng = before;
+                break;
+            }
+            i++;
+        }
+        blocks++;
+
+        // replay the stream of this block and compare
+        uint32_t after = rng;
+        rng = seed;
+        capture_log_decoder_init(&dec, buf, enc.length, enc.base_ms);
+        for (uint32_t j = first; j < i; j++) {
+            make_record(j, &in);
+            if (capture_log_decode(&dec, &out) != 1 || !same_record(&in, &out)) {
+                ok = false;
+                break;
+            }
+            decoded++;
+        }
+        if (ok && capture_log_decode(&dec, &out) != 0) {
+            ok = false;
+        }
+        rng = after;
+    }
+    expect("codec round trip", ok && decoded == CHECK_RECORDS && blocks > 1);
+}
+
+// Decode the partition in sector sequence order, checking that records come out in time order
+static uint32_t read_partition(uint32_t *last_ms, uint32_t *max_sequence, uint16_t *max_boot, bool *ordered){
+    const uint8_t *flash = host_partition_data();
+    uint32_t order[CHECK_SECTORS];
+    uint32_t valid = 0;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < CHECK_SECTORS; i++) {
+        capture_log_sector_header_t header;
+        memcpy(&header, flash + i * CAPTURE_LOG_SECTOR_SIZE, sizeof(header));
+        if (header.magic != CAPTURE_LOG_MAGIC) {
+            continue;
+        }
+        // insertion sort by sequence
+        uint32_t pos = valid++;
+        while (pos > 0) {
+            capture_log_sector_header_t prev;
+            memcpy(&prev, flash + order[pos - 1] * CAPTURE_LOG_SECTOR_SIZE, sizeof(prev));
+            if (prev.sequence < header.sequence) {
+                break;
+            }
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+    }
+
+    *ordered = true;
+    *last_ms = 0;
+    for (uint32_t i = 0; i < valid; i++) {
+        const uint8_t *sector = flash + order[i] * CAPTURE_LOG_SECTOR_SIZE;
+        capture_log_sector_header_t sector_header;
+        memcpy(&sector_header, sector, sizeof(sector_header));
+        *max_sequence = sector_header.sequence;
+        *max_boot = sector_header.boot;
+
+        uint32_t offset = sizeof(sector_header);
+        while (offset + sizeof(capture_log_block_header_t) <= CAPTURE_LOG_SECTOR_SIZE) {
+            capture_log_block_header_t header;
+            memcpy(&header, sector + offset, sizeof(header));
+            if (header.length == CAPTURE_LOG_BLOCK_UNWRITTEN) {
+                break;
+            }
+            uint32_t payload = offset + sizeof(header);
+            if (capture_log_crc16(sector + payload, header.length) != header.crc) {
+                *ordered = false;
+                break;
+            }
+            capture_log_decoder_t dec;
+            capture_log_record_t record;
+            capture_log_decoder_init(&dec, sector + payload, header.length, header.base_ms);
+            while (capture_log_decode(&dec, &record) == 1) {
+                if (record.timestamp_ms < *last_ms) {
+                    *ordered = false;
+                }
+                *last_ms = record.timestamp_ms;
+                count++;
+            }
+            offset = (payload + header.length + 3) & ~3u;
+        }
+    }
+    return count;
+}
+
+// Feed records through the block writer
+static uint32_t write_records(uint32_t first, uint32_t count, uint32_t *last_ms){
+    capture_log_record_t record;
+    for (uint32_t i = first; i < first + count; i++) {
+        make_record(i, &record);
+        if (!capture_log_encode(&encoder, &record)) {
+            capture_log_write_block();
+            capture_log_encode(&encoder, &record);
+        }
+        *last_ms = record.timestamp_ms;
+    }
+    capture_log_write_block();
+    return first + count;
+}
+
+// Write the ring around several times, reboot and resume, then fail the flash
+static void check_sector_ring(void){
+    uint32_t written_ms, read_ms, sequence = 0;
+    uint16_t boot_read = 0;
+    bool ordered;
+
+    host_partition_create(CAPTURE_LOG_PARTITION, CHECK_SECTORS * CAPTURE_LOG_SECTOR_SIZE);
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, CAPTURE_LOG_PARTITION);
+    capture_log_resume();
+    capture_log_encoder_init(&encoder, block, sizeof(block));
+    dropped = 0;
+
+    // several times the capacity of the ring, only the newest sectors survive
+    rng = 1;
+    uint32_t next = write_records(0, 10 * CHECK_RECORDS, &written_ms);
+    uint32_t kept = read_partition(&read_ms, &sequence, &boot_read, &ordered);
+    expect("ring wraps and keeps the newest records in order",
+           ordered && sequence >= CHECK_SECTORS && kept > 0 && kept < 10 * CHECK_RECORDS &&
+           read_ms == written_ms && boot_read == 0);
+
+    // a reboot continues after the newest sector with the next boot number
+    uint32_t before = sequence;
+    capture_log_resume();
+    capture_log_encoder_init(&encoder, block, sizeof(block));
+    next = write_records(next, 10, &written_ms);
+    read_partition(&read_ms, &sequence, &boot_read, &ordered);
+    expect("resume opens the next sector in the next boot",
+           ordered && read_ms == written_ms && sequence == before + 1 && boot_read == 1);
+
+    // a failing flash drops and counts the block and leaves the writer idle
+    capture_log_record_t record;
+    make_record(next++, &record);
+    capture_log_encode(&encoder, &record);
+    make_record(next++, &record);
+    capture_log_encode(&encoder, &record);
+    sector_offset = CAPTURE_LOG_SECTOR_SIZE;
+    host_partition_fail(true);
+    esp_err_t err = capture_log_write_block();
+    expect("failed sector erase drops the block", err != ESP_OK && dropped == 2 && encoder.count == 0);
+
+    make_record(next++, &record);
+    capture_log_encode(&encoder, &record);
+    err = capture_log_write_block();
+    expect("repeated flash errors keep dropping blocks", err != ESP_OK && dropped == 3 && encoder.count == 0);
+
+    // once the flash recovers the writer carries on in a fresh sector
+    host_partition_fail(false);
+    next = write_records(next, 10, &written_ms);
+    read_partition(&read_ms, &sequence, &boot_read, &ordered);
+    expect("writer recovers after flash errors", ordered && read_ms == written_ms && dropped == 3);
+}
+
+int main(void){
+    check_round_trip();
+    check_sector_ring();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// Loss estimation of the sequence tracker on gap-free and lossy mixed streams, exits non-zero on failure
+
+#include "seq_tracker/seq_tracker.h"
+#include "traffic_gen.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FC_PROBE_REQ 0x40
+#define FC_DATA 0x08
+#define FC_QOS_DATA 0x88
+#define FC_FLAG_RETRY 0x08
+
+static const uint8_t station[6] = { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+static const uint8_t access_point[6] = { 0x02, 0xaa, 0xbb, 0xcc, 0xdd, 0x01 };
+static int failures = 0;
+
+// Feed one frame from a transmitter to a receiver
+static bool feed_to(const uint8_t *transmitter, const uint8_t *receiver, uint8_t frame_control, uint16_t seq,
+                    uint8_t tid, bool retry){
+    uint8_t frame[26] = { 0 };
+    frame[0] = frame_control;
+    frame[1] = retry ? FC_FLAG_RETRY : 0;
+    memcpy(frame + 4, receiver, 6);
+    memcpy(frame + 10, transmitter, 6);
+    frame[22] = (uint8_t)(seq << 4);
+    frame[23] = (uint8_t)(seq >> 4);
+    frame[24] = tid;
+    return seq_tracker_check(frame, sizeof(frame));
+}
+
+// Feed one frame from the station to the access point
+static bool feed(uint8_t frame_control, uint16_t seq, uint8_t tid, bool retry){
+    return feed_to(station, access_point, frame_control, seq, tid, retry);
+}
+
+static void expect_link(const char *name, const uint8_t *transmitter, uint32_t lost, uint32_t duplicates){
+    seq_link_t link;
+    if (seq_tracker_get_link(transmitter, &link) != ESP_OK || link.lost != lost || link.duplicates != duplicates) {
+        printf("FAIL %s: lost %lu duplicates %lu, expected %lu and %lu\n", name, (unsigned long)link.lost,
+               (unsigned long)link.duplicates, (unsigned long)lost, (unsigned long)duplicates);
+        failures++;
+    } else {
+        printf("ok   %s\n", name);
+    }
+    seq_tracker_clear();
+}
+
+static void expect(const char *name, uint32_t lost, uint32_t duplicates){
+    expect_link(name, station, lost, duplicates);
+}
+
+int main(void){
+    // probe requests and non-QoS data share the transmitter's counter
+    for (uint16_t seq = 4090; seq < 4090 + 60; seq++) {
+        feed(seq % 3 == 0 ? FC_PROBE_REQ : FC_DATA, seq & 0x0fff, 0, false);
+    }
+    expect("gap-free management and non-QoS data", 0, 0);
+
+    // QoS data of two TIDs is numbered apart from management frames
+    uint16_t shared = 100;
+    uint16_t qos[2] = { 2000, 3000 };
+    for (int i = 0; i < 60; i++) {
+        if (i % 4 == 0) {
+            feed(FC_PROBE_REQ, shared++, 0, false);
+        } else {
+            uint8_t tid = i % 8 < 4 ? 0 : 5;
+            feed(FC_QOS_DATA, qos[tid != 0]++, tid, false);
+        }
+    }
+    expect("gap-free management and QoS data", 0, 0);
+
+    // missing frames and a retransmission
+    feed(FC_DATA, 10, 0, false);
+    feed(FC_PROBE_REQ, 11, 0, false);
+    feed(FC_DATA, 15, 0, false);
+    feed(FC_DATA, 15, 0, true);
+    feed(FC_QOS_DATA, 500, 0, false);
+    feed(FC_QOS_DATA, 503, 0, false);
+    expect("lossy mixed stream", 5, 1);
+
+    // downlink QoS data of an AP is numbered per station, interleaved streams are gap-free
+    uint8_t receivers[SEQ_TRACKER_QOS_STREAMS + 2][6];
+    uint16_t downlink[SEQ_TRACKER_QOS_STREAMS + 2];
+    for (int r = 0; r < SEQ_TRACKER_QOS_STREAMS + 2; r++) {
+        memcpy(receivers[r], station, 6);
+        receivers[r][5] = (uint8_t)(0x60 + r);
+        downlink[r] = (uint16_t)(r * 700);
+    }
+    for (int i = 0; i < 40; i++) {
+        feed_to(access_point, receivers[i % 2], FC_QOS_DATA, downlink[i % 2]++, 0, false);
+    }
+    expect_link("gap-free downlink to two stations", access_point, 0, 0);
+
+    // a retransmission to one station after a frame to another is still a duplicate
+    feed_to(access_point, receivers[0], FC_QOS_DATA, 40, 0, false);
+    feed_to(access_point, receivers[1], FC_QOS_DATA, 900, 0, false);
+    feed_to(access_point, receivers[0], FC_QOS_DATA, 40, 0, true);
+    feed_to(access_point, receivers[0], FC_QOS_DATA, 43, 0, false);
+    expect_link("lossy downlink with a retransmission", access_point, 2, 1);
+
+    // more stations than followed streams resynchronize instead of counting loss
+    for (int r = 0; r < SEQ_TRACKER_QOS_STREAMS + 2; r++) {
+        downlink[r] = (uint16_t)(r * 700);
+    }
+    for (int i = 0; i < 120; i++) {
+        int r = i % (SEQ_TRACKER_QOS_STREAMS + 2);
+        feed_to(access_point, receivers[r], FC_QOS_DATA, downlink[r]++, 0, false);
+    }
+    expect_link("gap-free downlink to many stations", access_point, 0, 0);
+
+    // broadcast QoS data shares the counter of management frames
+    uint8_t broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    for (uint16_t seq = 10; seq < 40; seq++) {
+        feed_to(access_point, seq % 2 ? broadcast : receivers[0], seq % 2 ? FC_QOS_DATA : FC_PROBE_REQ, seq, 0, false);
+    }
+    expect_link("gap-free broadcast QoS data and management", access_point, 0, 0);
+
+    // generated up- and downlink traffic with retransmissions but no loss, few enough devices to rarely collide
+    traffic_gen_config_t config = TRAFFIC_GEN_DEFAULT_CONFIG();
+    config.device_count = 40;
+    config.churn = 0;
+    traffic_gen_t *gen = traffic_gen_new(&config);
+    uint32_t retransmissions = 0;
+    for (int i = 0; i < 20000; i++) {
+        wifi_promiscuous_pkt_type_t type;
+        int64_t timestamp;
+        const wifi_promiscuous_pkt_t *pkt = traffic_gen_next(gen, &type, &timestamp);
+        retransmissions += (pkt->payload[1] & FC_FLAG_RETRY) != 0;
+        seq_tracker_check(pkt->payload, pkt->rx_ctrl.sig_len);
+    }
+    uint32_t lost = 0, duplicates = 0;
+    for (uint32_t i = 0; i < config.device_count; i++) {
+        seq_link_t link;
+        if (seq_tracker_get_link(traffic_gen_device_mac(gen, i), &link) == ESP_OK) {
+            lost += link.lost;
+            duplicates += link.duplicates;
+        }
+    }
+    traffic_gen_destroy(gen);
+    if (lost != 0 || duplicates * 10 < retransmissions * 9 || duplicates > retransmissions) {
+        printf("FAIL generated traffic: lost %lu duplicates %lu of %lu retransmissions\n", (unsigned long)lost,
+               (unsigned long)duplicates, (unsigned long)retransmissions);
+        failures++;
+    } else {
+        printf("ok   generated traffic, %lu of %lu retransmissions detected\n", (unsigned long)duplicates,
+               (unsigned long)retransmissions);
+    }
+    seq_tracker_clear();
+
+    return failures == 0 ? 0 : 1;
+}
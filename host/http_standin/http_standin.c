@@ -0,0 +1,186 @@
+// Host stand-in for the management AP's HTTP layer: fills the device tables with synthetic traffic,
+// then renders a request the way the firmware does, as an HTTP/1.1 chunked response on stdout:
+//   sniffy_http_standin [--devices N] [--seed N] [--bench N] [PATH]
+// PATH is /devices[?query], /aps or /counters, /devices by default. With --bench the response is
+// rendered N times and only its size, chunk count and rendering time are printed.
+
+#include "traffic_gen.h"
+#include "host_stubs.h"
+#include "esp_timer.h"
+#include "deauth/deauth.h"
+#include "mgmt_ap/stats_json.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define STANDIN_MAX_FRAMES 100000000ULL
+
+// What the sink saw of a response
+typedef struct {
+    FILE *out;                          // NULL to only count
+    uint64_t bytes;
+    uint32_t chunks;
+    size_t max_chunk;
+} standin_response_t;
+
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Stand-in for httpd_resp_send_chunk()
+static esp_err_t standin_sink(void *ctx, const char *data, size_t len){
+    standin_response_t *response = (standin_response_t *)ctx;
+    response->bytes += len;
+    response->chunks++;
+    if (len > response->max_chunk) {
+        response->max_chunk = len;
+    }
+    if (response->out != NULL) {
+        fprintf(response->out, "%zx\r\n", len);
+        fwrite(data, 1, len, response->out);
+        fputs("\r\n", response->out);
+    }
+    return ESP_OK;
+}
+
+// Status line and headers, sent once the request is known to be valid
+static void standin_headers(standin_response_t *response){
+    if (response->out != NULL) {
+        fprintf(response->out, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n");
+    }
+}
+
+// Render a path through the writer, as the firmware's URI handlers do
+static esp_err_t standin_render(const char *path, standin_response_t *response){
+    stats_json_writer_t writer;
+    esp_err_t err;
+
+    stats_json_writer_init(&writer, standin_sink, response);
+    const char *query = strchr(path, '?');
+    size_t path_len = query != NULL ? (size_t)(query - path) : strlen(path);
+    if (path_len == 8 && strncmp(path, "/devices", 8) == 0) {
+        device_query_t device_query;
+        uint32_t limit;
+        err = stats_json_parse_device_query(query != NULL ? query + 1 : NULL, &device_query, &limit);
+        if (err != ESP_OK) {
+            return err;
+        }
+        standin_headers(response);
+        err = stats_json_devices(&writer, &device_query, limit);
+    } else if (path_len == 4 && strncmp(path, "/aps", 4) == 0) {
+        standin_headers(response);
+        err = stats_json_aps(&writer);
+    } else if (path_len == 9 && strncmp(path, "/counters", 9) == 0) {
+        standin_headers(response);
+        err = stats_json_counters(&writer);
+    } else {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (err == ESP_OK) {
+        err = stats_json_flush(&writer);
+    }
+    return err;
+}
+
+// Total number of devices in the tables
+static uint32_t tracked_devices(void){
+    return get_device_count(0);
+}
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s [--devices N] [--seed N] [--bench N] [/devices?query | /aps | /counters]\n", name);
+}
+
+int main(int argc, char **argv){
+    traffic_gen_config_t config = TRAFFIC_GEN_DEFAULT_CONFIG();
+    uint32_t target = 5000;
+    uint32_t bench = 0;
+    const char *path = "/devices";
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (arg[0] == '/') {
+            path = arg;
+            continue;
+        }
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (strcmp(arg, "--devices") == 0) {
+            target = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoull(value, NULL, 0);
+        } else if (strcmp(arg, "--bench") == 0) {
+            bench = (uint32_t)strtoul(value, NULL, 0);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // twice as many generated devices as wanted, the Zipf tail takes long to show up
+    config.device_count = target * 2 > 1000 ? target * 2 : 1000;
+    traffic_gen_t *gen = traffic_gen_new(&config);
+    if (gen == NULL) {
+        fprintf(stderr, "Invalid generator configuration\n");
+        return 1;
+    }
+
+    // fill the tables through the promiscuous callback
+    start_sniffer(1);
+    wifi_promiscuous_cb_t callback = host_promiscuous_rx_cb();
+    int64_t time_offset = esp_timer_get_time();
+    for (uint64_t frames = 1; frames <= STANDIN_MAX_FRAMES; frames++) {
+        wifi_promiscuous_pkt_type_t type;
+        int64_t timestamp;
+        const wifi_promiscuous_pkt_t *pkt = traffic_gen_next(gen, &type, &timestamp);
+        host_set_time(time_offset + timestamp);
+        callback((void *)pkt, type);
+        if ((frames & 0xff) == 0 && tracked_devices() >= target) {
+            break;
+        }
+    }
+    traffic_gen_destroy(gen);
+
+    standin_response_t response = { 0 };
+    if (bench == 0) {
+        response.out = stdout;
+        esp_err_t err = standin_render(path, &response);
+        if (err == ESP_ERR_NOT_FOUND || (err != ESP_OK && response.chunks == 0)) {
+            printf("HTTP/1.1 %s\r\nContent-Length: 0\r\n\r\n", err == ESP_ERR_NOT_FOUND ? "404 Not Found" : "400 Bad Request");
+            return 1;
+        }
+        if (err != ESP_OK) {
+            // the status line is already sent, the firmware closes the connection here
+            fprintf(stderr, "%s: %s\n", path, esp_err_to_name(err));
+            return 1;
+        }
+        printf("0\r\n\r\n");
+        return 0;
+    }
+
+    double best_ns = 0;
+    for (uint32_t i = 0; i < bench; i++) {
+        memset(&response, 0, sizeof(response));
+        double start = now_ns();
+        esp_err_t err = standin_render(path, &response);
+        double elapsed_ns = now_ns() - start;
+        if (err != ESP_OK) {
+            fprintf(stderr, "%s: %s\n", path, esp_err_to_name(err));
+            return 1;
+        }
+        if (i == 0 || elapsed_ns < best_ns) {
+            best_ns = elapsed_ns;
+        }
+    }
+    printf("%s: %u devices tracked, %llu bytes in %u chunks (max %zu), writer %zu bytes, %.0f us\n",
+           path, tracked_devices(), (unsigned long long)response.bytes, response.chunks, response.max_chunk,
+           sizeof(stats_json_writer_t), best_ns / 1000);
+    return 0;
+}
@@ -0,0 +1,21 @@
+// Host stand-in for ESP-IDF's esp_log.h, logs go to stderr when host_log_enabled is set
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+extern bool host_log_enabled;
+
+#define HOST_LOG(level, tag, format, ...) do {                                      \
+    if (host_log_enabled) {                                                         \
+        fprintf(stderr, level " (%s): " format "\n", tag, ##__VA_ARGS__);          \
+    }                                                                               \
+} while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG("D", tag, format, ##__VA_ARGS__)
+
+#endif // HOST_ESP_LOG_H
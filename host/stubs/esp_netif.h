@@ -0,0 +1,12 @@
+// Host stand-in for ESP-IDF's esp_netif.h
+#ifndef HOST_ESP_NETIF_H
+#define HOST_ESP_NETIF_H
+
+#include "esp_err.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key);
+esp_netif_t *esp_netif_create_default_wifi_ap(void);
+
+#endif // HOST_ESP_NETIF_H
@@ -0,0 +1,18 @@
+// Host stand-in for the string functions newlib provides on the target but older glibc lacks,
+// force-included into the firmware sources only when the host C library misses them
+#ifndef HOST_STRING_H
+#define HOST_STRING_H
+
+#include <string.h>
+
+static inline size_t strlcpy(char *dst, const char *src, size_t size){
+    size_t len = strlen(src);
+    if (size != 0) {
+        size_t copy = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, copy);
+        dst[copy] = '\0';
+    }
+    return len;
+}
+
+#endif // HOST_STRING_H
@@ -0,0 +1,413 @@
+// Host stand-ins of the ESP-IDF and FreeRTOS APIs used by the firmware
+#include "host_stubs.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "esp_wifi.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HOST_MAX_TIMERS 8
+
+struct esp_timer {
+    void (*callback)(void *arg);
+    void *arg;
+    uint64_t period_us;
+    int64_t deadline_us;
+    bool armed;
+};
+
+struct host_timer {
+    TimerCallbackFunction_t callback;
+};
+
+bool host_log_enabled = false;
+
+static int64_t now_us = 0;
+static struct esp_timer timers[HOST_MAX_TIMERS];
+static wifi_promiscuous_cb_t rx_cb = NULL;
+static wifi_mode_t wifi_mode = WIFI_MODE_NULL;
+static uint8_t wifi_channel = 1;
+static uint8_t wifi_mac[2][6];
+static int netif_ap = 0;
+static uint32_t event_posts = 0;
+
+// Errors
+
+const char *esp_err_to_name(esp_err_t code){
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+// Virtual clock
+
+void host_set_time(int64_t time_us){
+    now_us = time_us;
+    for (int i = 0; i < HOST_MAX_TIMERS; i++) {
+        struct esp_timer *timer = &timers[i];
+        if (timer->armed && timer->deadline_us <= now_us) {
+            // a periodic timer fires once per call even if several periods passed
+            timer->armed = timer->period_us != 0;
+            timer->deadline_us = now_us + (int64_t)timer->period_us;
+            timer->callback(timer->arg);
+        }
+    }
+}
+
+void host_advance_time(int64_t delta_us){
+    host_set_time(now_us + delta_us);
+}
+
+int64_t esp_timer_get_time(void){
+    return now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle){
+    for (int i = 0; i < HOST_MAX_TIMERS; i++) {
+        if (timers[i].callback == NULL) {
+            timers[i].callback = create_args->callback;
+            timers[i].arg = create_args->arg;
+            timers[i].armed = false;
+            *out_handle = &timers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period){
+    timer->period_us = period;
+    timer->deadline_us = now_us + (int64_t)period;
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us){
+    timer->period_us = 0;
+    timer->deadline_us = now_us + (int64_t)timeout_us;
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer){
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer){
+    memset(timer, 0, sizeof(struct esp_timer));
+    return ESP_OK;
+}
+
+// Wi-Fi driver, frames are injected by calling host_promiscuous_rx_cb() directly
+
+wifi_promiscuous_cb_t host_promiscuous_rx_cb(void){
+    return rx_cb;
+}
+
+uint8_t host_wifi_channel(void){
+    return wifi_channel;
+}
+
+esp_err_t esp_wifi_start(void){
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void){
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode){
+    wifi_mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode){
+    *mode = wifi_mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second){
+    (void)second;
+    if (primary == 0 || primary > 14) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    wifi_channel = primary;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool en){
+    (void)en;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter){
+    (void)filter;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb){
+    rx_cb = cb;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mac(wifi_interface_t ifx, const uint8_t *mac){
+    memcpy(wifi_mac[ifx == WIFI_IF_AP], mac, 6);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mac(wifi_interface_t ifx, uint8_t *mac){
+    memcpy(mac, wifi_mac[ifx == WIFI_IF_AP], 6);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf){
+    (void)interface;
+    (void)conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block){
+    (void)config;
+    (void)block;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t *number){
+    *number = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *ap_records){
+    (void)ap_records;
+    *number = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_80211_tx(wifi_interface_t ifx, const void *buffer, int len, bool en_sys_seq){
+    (void)ifx;
+    (void)buffer;
+    (void)len;
+    (void)en_sys_seq;
+    return ESP_OK;
+}
+
+// Network interfaces, only the default SoftAP interface exists
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key){
+    return strcmp(if_key, "WIFI_AP_DEF") == 0 && netif_ap ? (esp_netif_t *)&netif_ap : NULL;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_ap(void){
+    netif_ap = 1;
+    return (esp_netif_t *)&netif_ap;
+}
+
+// Event loop, posts are only counted
+
+uint32_t host_event_post_count(void){
+    return event_posts;
+}
+
+esp_err_t esp_event_loop_create_default(void){
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void *data, size_t size, TickType_t ticks){
+    (void)base;
+    (void)id;
+    (void)data;
+    (void)size;
+    (void)ticks;
+    event_posts++;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                              void *arg, esp_event_handler_instance_t *instance){
+    (void)base;
+    (void)id;
+    (void)handler;
+    (void)arg;
+    *instance = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t base, int32_t id, esp_event_handler_instance_t instance){
+    (void)base;
+    (void)id;
+    (void)instance;
+    return ESP_OK;
+}
+
+// Flash partitions, only the one created with host_partition_create() exists
+
+static esp_partition_t host_partition;
+static uint8_t *host_flash = NULL;
+static bool host_flash_fail = false;
+
+void host_partition_create(const char *label, uint32_t size){
+    free(host_flash);
+    host_flash = malloc(size);
+    memset(host_flash, 0xff, size);
+    memset(&host_partition, 0, sizeof(host_partition));
+    host_partition.type = ESP_PARTITION_TYPE_DATA;
+    host_partition.size = size;
+    strncpy(host_partition.label, label, sizeof(host_partition.label) - 1);
+    host_flash_fail = false;
+}
+
+void host_partition_fail(bool fail){
+    host_flash_fail = fail;
+}
+
+const uint8_t *host_partition_data(void){
+    return host_flash;
+}
+
+// Check an access against the created partition
+static bool host_partition_valid(const esp_partition_t *partition, size_t offset, size_t size){
+    return host_flash != NULL && partition == &host_partition && offset + size <= host_partition.size;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, int subtype, const char *label){
+    (void)subtype;
+    if (host_flash == NULL || type != host_partition.type || label == NULL || strcmp(label, host_partition.label) != 0) {
+        return NULL;
+    }
+    return &host_partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size){
+    if (!host_partition_valid(partition, src_offset, size)) {
+        return ESP_FAIL;
+    }
+    memcpy(dst, host_flash + src_offset, size);
+    return ESP_OK;
+}
+
+// Writes can only clear bits, like NOR flash
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size){
+    if (host_flash_fail || !host_partition_valid(partition, dst_offset, size)) {
+        return ESP_FAIL;
+    }
+    for (size_t i = 0; i < size; i++) {
+        host_flash[dst_offset + i] &= ((const uint8_t *)src)[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size){
+    if (host_flash_fail || !host_partition_valid(partition, offset, size)) {
+        return ESP_FAIL;
+    }
+    memset(host_flash + offset, 0xff, size);
+    return ESP_OK;
+}
+
+// FreeRTOS, delays advance the virtual clock and nothing is ever scheduled
+
+void vTaskDelay(TickType_t ticks){
+    host_advance_time((int64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount(void){
+    return (TickType_t)(now_us / (portTICK_PERIOD_MS * 1000));
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle){
+    (void)task;
+    (void)name;
+    (void)stack_depth;
+    (void)arg;
+    (void)priority;
+    (void)handle;
+    return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t task){
+    (void)task;
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload, void *id,
+                           TimerCallbackFunction_t callback){
+    (void)name;
+    (void)period;
+    (void)auto_reload;
+    (void)id;
+    TimerHandle_t timer = malloc(sizeof(struct host_timer));
+    if (timer != NULL) {
+        timer->callback = callback;
+    }
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks){
+    (void)timer;
+    (void)ticks;
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks){
+    (void)timer;
+    (void)ticks;
+    return pdPASS;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks){
+    (void)ticks;
+    free(timer);
+    return pdPASS;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size){
+    (void)length;
+    (void)item_size;
+    return NULL;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks){
+    (void)queue;
+    (void)item;
+    (void)ticks;
+    return pdFAIL;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks){
+    (void)queue;
+    (void)item;
+    (void)ticks;
+    return pdFAIL;
+}
+
+// binary semaphores are never given on the host, mutexes are always free as there is one thread
+SemaphoreHandle_t xSemaphoreCreateBinary(void){
+    return NULL;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void){
+    static int host_mutex;
+    return &host_mutex;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore){
+    return semaphore != NULL ? pdTRUE : pdFAIL;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks){
+    (void)ticks;
+    return semaphore != NULL ? pdTRUE : pdFAIL;
+}
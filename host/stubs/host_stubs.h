@@ -0,0 +1,33 @@
+// Controls for the host stand-ins of the ESP-IDF and FreeRTOS APIs
+#ifndef HOST_STUBS_H
+#define HOST_STUBS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_wifi_types.h"
+
+// Set the virtual clock, firing the esp_timers that became due
+void host_set_time(int64_t time_us);
+
+// Move the virtual clock forward
+void host_advance_time(int64_t delta_us);
+
+// Promiscuous RX callback registered by the firmware, NULL if none
+wifi_promiscuous_cb_t host_promiscuous_rx_cb(void);
+
+// Channel the firmware last tuned to
+uint8_t host_wifi_channel(void);
+
+// Number of events posted to the default event loop
+uint32_t host_event_post_count(void);
+
+// Create an erased flash partition, replacing the previous one
+void host_partition_create(const char *label, uint32_t size);
+
+// Make every flash write and erase fail, or succeed again
+void host_partition_fail(bool fail);
+
+// Contents of the flash partition
+const uint8_t *host_partition_data(void);
+
+#endif // HOST_STUBS_H
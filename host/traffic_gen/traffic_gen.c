@@ -0,0 +1,256 @@
+#include "traffic_gen.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FC_BEACON 0x80
+#define FC_PROBE_REQ 0x40
+#define FC_QOS_DATA 0x88
+#define FC_FLAG_TO_DS 0x01
+#define FC_FLAG_FROM_DS 0x02
+#define FC_FLAG_RETRY 0x08
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t channel;
+    int8_t rssi;            // mean RSSI of the device
+    uint16_t seq;           // next sequence number of management frames
+    uint16_t qos_seq;       // next sequence number of QoS data frames to the access point, TID 0
+    uint16_t downlink_seq;  // next sequence number of the access point's QoS data frames to this station, TID 0
+    uint32_t ap;            // access point of a station, itself for access points
+} traffic_gen_device_t;
+
+struct traffic_gen_t {
+    traffic_gen_config_t config;
+    traffic_gen_device_t *devices;
+    double *cdf;            // cumulative Zipf weights, device i has rank i + 1
+    uint32_t ap_count;
+    uint64_t rng;
+    uint64_t frame_index;
+    uint64_t mac_count;
+    bool has_last;
+    union {
+        wifi_promiscuous_pkt_t pkt;
+        uint8_t buf[sizeof(wifi_promiscuous_pkt_t) + TRAFFIC_GEN_FRAME_SIZE];
+    } frame;
+    wifi_promiscuous_pkt_type_t last_type;
+};
+
+// xorshift64*
+static uint64_t next_random(traffic_gen_t *gen){
+    gen->rng ^= gen->rng >> 12;
+    gen->rng ^= gen->rng << 25;
+    gen->rng ^= gen->rng >> 27;
+    return gen->rng * 0x2545f4914f6cdd1dULL;
+}
+
+// Uniform in [0, 1)
+static double next_uniform(traffic_gen_t *gen){
+    return (double)(next_random(gen) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Unicast MAC address, locally administered when randomized like modern phones do
+static void random_mac(traffic_gen_t *gen, uint8_t *mac, bool randomized){
+    uint64_t value = next_random(gen);
+    for (int i = 0; i < 6; i++) {
+        mac[i] = (uint8_t)(value >> (8 * i));
+    }
+    mac[0] &= 0xfe;
+    mac[0] = randomized ? mac[0] | 0x02 : mac[0] & ~0x02;
+    gen->mac_count++;
+}
+
+// Draw a device index following the Zipf distribution
+static uint32_t zipf_device(traffic_gen_t *gen){
+    double target = next_uniform(gen) * gen->cdf[gen->config.device_count - 1];
+    uint32_t low = 0;
+    uint32_t high = gen->config.device_count - 1;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (gen->cdf[mid] < target) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Draw a channel following the configured weights
+static uint8_t weighted_channel(traffic_gen_t *gen, uint32_t total){
+    uint32_t target = (uint32_t)(next_random(gen) % total);
+    for (uint8_t i = 0; i < 14; i++) {
+        if (target < gen->config.channel_weights[i]) {
+            return i + 1;
+        }
+        target -= gen->config.channel_weights[i];
+    }
+    return 1;
+}
+
+// Constructor for traffic_gen_t
+traffic_gen_t *traffic_gen_new(const traffic_gen_config_t *config){
+    if (config == NULL || config->device_count == 0 || config->device_count > TRAFFIC_GEN_MAX_DEVICES ||
+        config->frames_per_second == 0) {
+        return NULL;
+    }
+
+    uint32_t total_weight = 0;
+    for (int i = 0; i < 14; i++) {
+        total_weight += config->channel_weights[i];
+    }
+    if (total_weight == 0) {
+        return NULL;
+    }
+
+    traffic_gen_t *gen = calloc(1, sizeof(traffic_gen_t));
+    if (gen == NULL) {
+        return NULL;
+    }
+    gen->config = *config;
+    gen->rng = config->seed ? config->seed : 1;
+    gen->devices = malloc(config->device_count * sizeof(traffic_gen_device_t));
+    gen->cdf = malloc(config->device_count * sizeof(double));
+    if (gen->devices == NULL || gen->cdf == NULL) {
+        traffic_gen_destroy(gen);
+        return NULL;
+    }
+
+    // every step-th device is an access point with its own channel, stations join one of them
+    gen->ap_count = (uint32_t)(config->device_count * config->ap_ratio);
+    if (gen->ap_count == 0) {
+        gen->ap_count = 1;
+    } else if (gen->ap_count > config->device_count) {
+        gen->ap_count = config->device_count;
+    }
+    uint32_t step = config->device_count / gen->ap_count;
+    double sum = 0;
+    for (uint32_t i = 0; i < config->device_count; i++) {
+        traffic_gen_device_t *device = &gen->devices[i];
+        random_mac(gen, device->mac, false);
+        device->seq = (uint16_t)(next_random(gen) & 0x0fff);
+        device->qos_seq = (uint16_t)(next_random(gen) & 0x0fff);
+        device->downlink_seq = (uint16_t)(next_random(gen) & 0x0fff);
+        device->rssi = (int8_t)(-35 - (int)(next_random(gen) % 60));
+        if (i % step == 0) {
+            device->ap = i;
+            device->channel = weighted_channel(gen, total_weight);
+        } else {
+            // access points are set up before the stations that follow them
+            device->ap = step * (uint32_t)(next_random(gen) % (i / step + 1));
+            device->channel = gen->devices[device->ap].channel;
+        }
+        sum += 1.0 / pow((double)(i + 1), config->zipf_s);
+        gen->cdf[i] = sum;
+    }
+    return gen;
+}
+
+// Destructor for traffic_gen_t
+void traffic_gen_destroy(traffic_gen_t *gen){
+    if (gen == NULL) {
+        return;
+    }
+    free(gen->devices);
+    free(gen->cdf);
+    free(gen);
+}
+
+// Fill the RX control header of a frame
+static void fill_rx_ctrl(traffic_gen_t *gen, const traffic_gen_device_t *device, uint16_t length, bool ht, int64_t timestamp){
+    wifi_pkt_rx_ctrl_t *rx_ctrl = &gen->frame.pkt.rx_ctrl;
+    memset(rx_ctrl, 0, sizeof(wifi_pkt_rx_ctrl_t));
+    rx_ctrl->rssi = device->rssi + (int)(next_random(gen) % 7) - 3;
+    rx_ctrl->channel = device->channel;
+    rx_ctrl->timestamp = (uint32_t)timestamp;
+    rx_ctrl->sig_len = length;
+    rx_ctrl->noise_floor = -96;
+    if (ht) {
+        rx_ctrl->sig_mode = 1;
+        rx_ctrl->mcs = next_random(gen) % 8;
+    } else {
+        rx_ctrl->rate = 0x0b; // 6 Mbps OFDM
+    }
+}
+
+// Generate the next frame
+const wifi_promiscuous_pkt_t *traffic_gen_next(traffic_gen_t *gen, wifi_promiscuous_pkt_type_t *type, int64_t *timestamp){
+    int64_t now = (int64_t)(gen->frame_index++ * 1000000ULL / gen->config.frames_per_second);
+    uint8_t *frame = gen->frame.pkt.payload;
+    *timestamp = now;
+
+    // retransmit the previous frame unchanged apart from the retry bit
+    if (gen->has_last && next_uniform(gen) < gen->config.retry_ratio) {
+        frame[1] |= FC_FLAG_RETRY;
+        gen->frame.pkt.rx_ctrl.timestamp = (uint32_t)now;
+        *type = gen->last_type;
+        return &gen->frame.pkt;
+    }
+
+    uint32_t index = zipf_device(gen);
+    traffic_gen_device_t *device = &gen->devices[index];
+    bool is_ap = device->ap == index;
+    const traffic_gen_device_t *ap = &gen->devices[device->ap];
+    uint16_t *seq = &device->seq;
+    memset(frame, 0, TRAFFIC_GEN_FRAME_SIZE);
+
+    if (is_ap) {
+        // beacon from the access point to everyone
+        frame[0] = FC_BEACON;
+        memset(frame + 4, 0xff, 6);
+        memcpy(frame + 10, device->mac, 6);
+        memcpy(frame + 16, device->mac, 6);
+        fill_rx_ctrl(gen, device, (uint16_t)(200 + next_random(gen) % 100), false, now);
+        *type = WIFI_PKT_MGMT;
+    } else if (next_uniform(gen) < gen->config.probe_ratio) {
+        // probe request, phones randomize their MAC between scans
+        if (next_uniform(gen) < gen->config.churn) {
+            random_mac(gen, device->mac, true);
+        }
+        frame[0] = FC_PROBE_REQ;
+        memset(frame + 4, 0xff, 6);
+        memcpy(frame + 10, device->mac, 6);
+        memset(frame + 16, 0xff, 6);
+        fill_rx_ctrl(gen, device, (uint16_t)(100 + next_random(gen) % 60), false, now);
+        *type = WIFI_PKT_MGMT;
+    } else if (next_uniform(gen) < gen->config.downlink_ratio) {
+        // QoS data from the access point to the station, numbered per station
+        seq = &device->downlink_seq;
+        frame[0] = FC_QOS_DATA;
+        frame[1] = FC_FLAG_FROM_DS;
+        memcpy(frame + 4, device->mac, 6);
+        memcpy(frame + 10, ap->mac, 6);
+        memcpy(frame + 16, ap->mac, 6);
+        fill_rx_ctrl(gen, ap, (uint16_t)(64 + next_random(gen) % 1436), true, now);
+        *type = WIFI_PKT_DATA;
+    } else {
+        // QoS data from the station to its access point, TID 0 has its own sequence
+        seq = &device->qos_seq;
+        frame[0] = FC_QOS_DATA;
+        frame[1] = FC_FLAG_TO_DS;
+        memcpy(frame + 4, ap->mac, 6);
+        memcpy(frame + 10, device->mac, 6);
+        memcpy(frame + 16, ap->mac, 6);
+        fill_rx_ctrl(gen, device, (uint16_t)(64 + next_random(gen) % 1436), true, now);
+        *type = WIFI_PKT_DATA;
+    }
+
+    // sequence control, fragment number 0
+    frame[22] = (uint8_t)(*seq << 4);
+    frame[23] = (uint8_t)(*seq >> 4);
+    *seq = (*seq + 1) & 0x0fff;
+
+    gen->has_last = true;
+    gen->last_type = *type;
+    return &gen->frame.pkt;
+}
+
+// Current MAC address of a device
+const uint8_t *traffic_gen_device_mac(const traffic_gen_t *gen, uint32_t index){
+    return gen->devices[index % gen->config.device_count].mac;
+}
+
+// Number of distinct MAC addresses generated so far
+uint64_t traffic_gen_mac_count(const traffic_gen_t *gen){
+    return gen->mac_count;
+}
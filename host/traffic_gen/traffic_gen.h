@@ -0,0 +1,54 @@
+// Synthetic 802.11 traffic for driving the promiscuous callback on the host
+#ifndef TRAFFIC_GEN_H
+#define TRAFFIC_GEN_H
+
+#include <stdint.h>
+#include "esp_wifi_types.h"
+
+#define TRAFFIC_GEN_MAX_DEVICES 1000000
+#define TRAFFIC_GEN_FRAME_SIZE 64       // only the header is generated, sig_len carries the real length
+
+typedef struct {
+    uint32_t device_count;              // distinct devices, up to TRAFFIC_GEN_MAX_DEVICES
+    double zipf_s;                      // exponent of the Zipf distribution of activity over devices
+    double churn;                       // probability that a station randomizes its MAC before a frame
+    double ap_ratio;                    // fraction of devices that are access points
+    double probe_ratio;                 // fraction of station frames that are probe requests
+    double downlink_ratio;              // fraction of station data frames sent by the access point to the station
+    double retry_ratio;                 // fraction of frames that are retransmitted
+    uint32_t channel_weights[14];       // relative share of access points per channel
+    uint32_t frames_per_second;         // virtual frame rate, sets the frame timestamps
+    uint64_t seed;
+} traffic_gen_config_t;
+
+#define TRAFFIC_GEN_DEFAULT_CONFIG() {                                  \
+    .device_count = 10000,                                              \
+    .zipf_s = 1.0,                                                      \
+    .churn = 0.01,                                                      \
+    .ap_ratio = 0.05,                                                   \
+    .probe_ratio = 0.2,                                                 \
+    .downlink_ratio = 0.5,                                              \
+    .retry_ratio = 0.05,                                                \
+    .channel_weights = { 30, 1, 1, 1, 1, 30, 1, 1, 1, 1, 30, 1, 1, 0 }, \
+    .frames_per_second = 2000,                                          \
+    .seed = 1                                                           \
+}
+
+typedef struct traffic_gen_t traffic_gen_t;
+
+// Constructor for traffic_gen_t
+traffic_gen_t *traffic_gen_new(const traffic_gen_config_t *config);
+
+// Destructor for traffic_gen_t
+void traffic_gen_destroy(traffic_gen_t *gen);
+
+// Generate the next frame, valid until the next call
+const wifi_promiscuous_pkt_t *traffic_gen_next(traffic_gen_t *gen, wifi_promiscuous_pkt_type_t *type, int64_t *timestamp);
+
+// Current MAC address of a device
+const uint8_t *traffic_gen_device_mac(const traffic_gen_t *gen, uint32_t index);
+
+// Number of distinct MAC addresses generated so far, including randomized ones
+uint64_t traffic_gen_mac_count(const traffic_gen_t *gen);
+
+#endif // TRAFFIC_GEN_H
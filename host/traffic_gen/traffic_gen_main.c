@@ -0,0 +1,215 @@
+// Feed synthetic dense-environment traffic into the sniffer's promiscuous callback and report,
+// as the device tables grow, the cost of the callback and of the main table operations:
+//   sniffy_traffic_gen [--devices N] [--frames N] [--zipf S] [--churn P] [--aps P] [--probes P]
+//                      [--downlink P] [--retries P] [--channels 1:30,6:30,11:30] [--fps N] [--seed N] [--budget-us N]
+// The run stops once the callback exceeds the per-frame budget.
+
+#include "traffic_gen.h"
+#include "host_stubs.h"
+#include "esp_timer.h"
+#include "deauth/deauth.h"
+#include "device_list/device_list.h"
+#include "device_events/device_events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHECKPOINT_FIRST 1000
+#define QUERY_PAGE 50
+#define FIND_REPEAT 64
+
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Parse "1:30,6:30,11:30" into channel weights
+static int parse_channels(const char *arg, uint32_t *weights){
+    memset(weights, 0, 14 * sizeof(uint32_t));
+    char *copy = strdup(arg);
+    for (char *item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+        unsigned channel;
+        unsigned weight = 1;
+        if (sscanf(item, "%u:%u", &channel, &weight) < 1 || channel == 0 || channel > 14) {
+            free(copy);
+            return -1;
+        }
+        weights[channel - 1] = weight;
+    }
+    free(copy);
+    return 0;
+}
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s [--devices N] [--frames N] [--zipf S] [--churn P] [--aps P] [--probes P]\n"
+                    "          [--downlink P] [--retries P] [--channels 1:30,6:30,11:30] [--fps N] [--seed N] [--budget-us N]\n", name);
+}
+
+// Largest device list and its total size
+static device_list_t *largest_list(uint32_t *total){
+    device_list_t *largest = NULL;
+    *total = get_device_count(0);
+    for (uint8_t channel = 1; channel <= 14; channel++) {
+        device_list_t *list = get_device_list(channel);
+        if (largest == NULL || list->size > largest->size) {
+            largest = list;
+        }
+    }
+    return largest;
+}
+
+// Cost of the table operations at the current size
+static void report_checkpoint(uint32_t tracked, uint64_t frames, double callback_ns){
+    uint32_t total;
+    device_list_t *list = largest_list(&total);
+
+    // lookups of the last device in the list are the worst case hit
+    const device_node_t *last = list->head;
+    if (last == NULL) {
+        return;
+    }
+    while (last != NULL && last->next != NULL) {
+        last = last->next;
+    }
+    uint8_t missing[6] = { 0x02, 0xde, 0xad, 0xbe, 0xef, 0x00 };
+    volatile const device_node_t *sink = NULL;
+    double start = now_ns();
+    for (int i = 0; i < FIND_REPEAT; i++) {
+        sink = device_list_find(last->mac_addr, list);
+    }
+    double hit_ns = (now_ns() - start) / FIND_REPEAT;
+    start = now_ns();
+    for (int i = 0; i < FIND_REPEAT; i++) {
+        sink = device_list_find(missing, list);
+    }
+    double miss_ns = (now_ns() - start) / FIND_REPEAT;
+    (void)sink;
+
+    // first page of the busiest devices over all channels
+    device_cursor_t cursor;
+    device_entry_t entries[QUERY_PAGE];
+    device_query_t query = { .order = DEVICE_ORDER_ACTIVITY };
+    query_devices(&cursor, &query);
+    start = now_ns();
+    device_cursor_next_page(&cursor, entries, QUERY_PAGE);
+    double page_ns = now_ns() - start;
+    device_cursor_deinit(&cursor);
+
+    start = now_ns();
+    device_events_sweep(esp_timer_get_time());
+    double sweep_ns = now_ns() - start;
+
+    printf("%10u %12llu %12.0f %12.0f %12.0f %12.0f %12.0f\n", tracked, (unsigned long long)frames,
+           callback_ns, hit_ns, miss_ns, page_ns, sweep_ns);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv){
+    traffic_gen_config_t config = TRAFFIC_GEN_DEFAULT_CONFIG();
+    uint64_t frame_limit = 10000000;
+    double budget_us = 100;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+        if (strcmp(arg, "--devices") == 0) {
+            config.device_count = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--frames") == 0) {
+            frame_limit = strtoull(value, NULL, 0);
+        } else if (strcmp(arg, "--zipf") == 0) {
+            config.zipf_s = strtod(value, NULL);
+        } else if (strcmp(arg, "--churn") == 0) {
+            config.churn = strtod(value, NULL);
+        } else if (strcmp(arg, "--aps") == 0) {
+            config.ap_ratio = strtod(value, NULL);
+        } else if (strcmp(arg, "--probes") == 0) {
+            config.probe_ratio = strtod(value, NULL);
+        } else if (strcmp(arg, "--downlink") == 0) {
+            config.downlink_ratio = strtod(value, NULL);
+        } else if (strcmp(arg, "--retries") == 0) {
+            config.retry_ratio = strtod(value, NULL);
+        } else if (strcmp(arg, "--channels") == 0) {
+            if (parse_channels(value, config.channel_weights) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--fps") == 0) {
+            config.frames_per_second = (uint32_t)strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoull(value, NULL, 0);
+        } else if (strcmp(arg, "--budget-us") == 0) {
+            budget_us = strtod(value, NULL);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    traffic_gen_t *gen = traffic_gen_new(&config);
+    if (gen == NULL) {
+        fprintf(stderr, "Invalid generator configuration\n");
+        return 1;
+    }
+
+    // start_sniffer() registers the callback, its channel dwell only advances the virtual clock
+    start_sniffer(1);
+    wifi_promiscuous_cb_t callback = host_promiscuous_rx_cb();
+    device_events_config_t events_config = DEVICE_EVENTS_DEFAULT_CONFIG();
+    events_config.interval_ms = 0;
+    start_device_events(&events_config);
+    int64_t time_offset = esp_timer_get_time();
+
+    printf("%10s %12s %12s %12s %12s %12s %12s\n",
+           "tracked", "frames", "callback_ns", "find_hit_ns", "find_miss_ns", "page_ns", "sweep_ns");
+
+    uint32_t checkpoint = CHECKPOINT_FIRST;
+    uint64_t window_frames = 0;
+    double window_ns = 0;
+    uint32_t tracked = 0;
+    uint64_t frames = 0;
+    while (frames < frame_limit) {
+        wifi_promiscuous_pkt_type_t type;
+        int64_t timestamp;
+        const wifi_promiscuous_pkt_t *pkt = traffic_gen_next(gen, &type, &timestamp);
+        host_set_time(time_offset + timestamp);
+
+        double start = now_ns();
+        callback((void *)pkt, type);
+        window_ns += now_ns() - start;
+        window_frames++;
+        frames++;
+
+        // the table size only needs checking now and then
+        if ((frames & 0x3ff) != 0) {
+            continue;
+        }
+        largest_list(&tracked);
+        if (tracked < checkpoint) {
+            continue;
+        }
+
+        double callback_ns = window_ns / (double)window_frames;
+        report_checkpoint(tracked, frames, callback_ns);
+        window_frames = 0;
+        window_ns = 0;
+        while (checkpoint <= tracked) {
+            checkpoint *= 2;
+        }
+        if (callback_ns > budget_us * 1000) {
+            printf("callback exceeds the %.0f us budget at %u tracked devices\n", budget_us, tracked);
+            break;
+        }
+    }
+
+    printf("%llu frames, %llu MAC addresses generated, %u tracked\n", (unsigned long long)frames,
+           (unsigned long long)traffic_gen_mac_count(gen), tracked);
+    traffic_gen_destroy(gen);
+    return 0;
+}
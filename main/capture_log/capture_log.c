@@ -0,0 +1,291 @@
+#include "capture_log.h"
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+// Queue markers handled by the writer task, never written to flash
+#define CAPTURE_LOG_FLUSH 0xfe
+#define CAPTURE_LOG_STOP 0xff
+
+static const esp_partition_t *partition = NULL;
+static QueueHandle_t record_queue = NULL;
+static SemaphoreHandle_t done_semaphore = NULL;
+static volatile bool running = false;
+static bool frames_enabled = false;
+static uint32_t dropped = 0;
+
+// Position of the writer in the sector ring
+static uint32_t sector_count;
+static uint32_t sector_index;
+static uint32_t sector_offset;
+static uint32_t sequence;
+static uint16_t boot;
+
+static uint8_t block[CAPTURE_LOG_BLOCK_SIZE];
+static capture_log_encoder_t encoder;
+
+// Find the most recent sector and continue after it, so the ring wraps evenly over the partition
+static void capture_log_resume(void){
+    capture_log_sector_header_t header;
+    bool found = false;
+
+    sector_count = partition->size / CAPTURE_LOG_SECTOR_SIZE;
+    sector_index = sector_count - 1;
+    sequence = 0;
+    boot = 0;
+    for (uint32_t i = 0; i < sector_count; i++) {
+        if (esp_partition_read(partition, i * CAPTURE_LOG_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK) {
+            continue;
+        }
+        if (header.magic != CAPTURE_LOG_MAGIC || header.version != CAPTURE_LOG_VERSION) {
+            continue;
+        }
+        if (!found || header.sequence > sequence) {
+            found = true;
+            sequence = header.sequence;
+            sector_index = i;
+            boot = header.boot + 1;
+        }
+    }
+
+    // a partially written sector is never appended to, the next block opens a fresh sector
+    sequence = found ? sequence + 1 : 0;
+    sector_offset = CAPTURE_LOG_SECTOR_SIZE;
+    ESP_LOGI(CAPTURE_LOG_TAG, "Log has %lu sectors, resuming at sector %lu, boot %u",
+             (unsigned long)sector_count, (unsigned long)((sector_index + 1) % sector_count), boot);
+}
+
+// Erase the next sector of the ring and write its header
+static esp_err_t capture_log_next_sector(void){
+    sector_index = (sector_index + 1) % sector_count;
+    uint32_t address = sector_index * CAPTURE_LOG_SECTOR_SIZE;
+
+    esp_err_t err = esp_partition_erase_range(partition, address, CAPTURE_LOG_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(CAPTURE_LOG_TAG, "Failed to erase sector %lu", (unsigned long)sector_index);
+        return err;
+    }
+
+    capture_log_sector_header_t header = {
+        .magic = CAPTURE_LOG_MAGIC,
+        .sequence = sequence++,
+        .boot = boot,
+        .version = CAPTURE_LOG_VERSION
+    };
+    err = esp_partition_write(partition, address, &header, sizeof(header));
+    if (err != ESP_OK) {
+        ESP_LOGE(CAPTURE_LOG_TAG, "Failed to write sector header");
+        return err;
+    }
+    sector_offset = sizeof(header);
+    return ESP_OK;
+}
+
+// Give up on the current block after a flash error, counting its records as dropped
+static void capture_log_drop_block(void){
+    __atomic_fetch_add(&dropped, encoder.count, __ATOMIC_RELAXED);
+    capture_log_encoder_init(&encoder, block, sizeof(block));
+
+    // back off so a failing flash does not keep the writer task busy
+    vTaskDelay(pdMS_TO_TICKS(CAPTURE_LOG_RETRY_MS));
+}
+
+// Write the current block to flash and start a new one
+static esp_err_t capture_log_write_block(void){
+    if (encoder.count == 0) {
+        return ESP_OK;
+    }
+
+    uint32_t block_size = sizeof(capture_log_block_header_t) + encoder.length;
+    if (sector_offset + block_size > CAPTURE_LOG_SECTOR_SIZE) {
+        esp_err_t err = capture_log_next_sector();
+        if (err != ESP_OK) {
+            // the next attempt moves on to the following sector
+            sector_offset = CAPTURE_LOG_SECTOR_SIZE;
+            capture_log_drop_block();
+            return err;
+        }
+    }
+
+    // the header goes last, so a block cut short by a power loss still reads as unwritten
+    uint32_t address = sector_index * CAPTURE_LOG_SECTOR_SIZE + sector_offset;
+    capture_log_block_header_t header = {
+        .length = encoder.length,
+        .crc = capture_log_crc16(block, encoder.length),
+        .base_ms = encoder.base_ms
+    };
+    esp_err_t err = esp_partition_write(partition, address + sizeof(header), block, encoder.length);
+    if (err == ESP_OK) {
+        err = esp_partition_write(partition, address, &header, sizeof(header));
+    }
+
+    // keep blocks word aligned, a failed block still used up its space
+    sector_offset += (block_size + 3) & ~3u;
+    if (err != ESP_OK) {
+        ESP_LOGE(CAPTURE_LOG_TAG, "Failed to write block");
+        capture_log_drop_block();
+        return err;
+    }
+    capture_log_encoder_init(&encoder, block, sizeof(block));
+    return ESP_OK;
+}
+
+// Writer task, batches records into blocks so flash latency never reaches the capture path
+static void capture_log_task(void *arg){
+    capture_log_record_t record;
+    TickType_t flush_at = 0;    // tick by which the oldest record of the block must be written
+
+    while (true) {
+        // wait for records until the oldest buffered one is due, however slowly they trickle in
+        TickType_t wait = portMAX_DELAY;
+        if (encoder.count != 0) {
+            TickType_t remaining = flush_at - xTaskGetTickCount();
+            if ((int32_t)remaining <= 0) {
+                capture_log_write_block();
+                continue;
+            }
+            wait = remaining;
+        }
+        if (xQueueReceive(record_queue, &record, wait) != pdTRUE) {
+            continue;
+        }
+
+        if (record.type == CAPTURE_LOG_FLUSH || record.type == CAPTURE_LOG_STOP) {
+            capture_log_write_block();
+            xSemaphoreGive(done_semaphore);
+            if (record.type == CAPTURE_LOG_STOP) {
+                break;
+            }
+            continue;
+        }
+
+        // the block is empty after a write, even a failed one, so the record always fits
+        if (!capture_log_encode(&encoder, &record)) {
+            capture_log_write_block();
+            capture_log_encode(&encoder, &record);
+        }
+        if (encoder.count == 1) {
+            flush_at = xTaskGetTickCount() + pdMS_TO_TICKS(CAPTURE_LOG_FLUSH_MS);
+        }
+    }
+
+    vTaskDelete(NULL);
+}
+
+// Queue a marker and wait for the writer task to handle it
+static esp_err_t capture_log_send_marker(uint8_t type){
+    capture_log_record_t record = { .type = type };
+    if (xQueueSend(record_queue, &record, portMAX_DELAY) != pdTRUE) {
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(done_semaphore, portMAX_DELAY);
+    return ESP_OK;
+}
+
+// Open the log partition and start the writer task
+esp_err_t capture_log_start(bool log_frames){
+    if (running) {
+        frames_enabled = log_frames;
+        return ESP_OK;
+    }
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, CAPTURE_LOG_PARTITION);
+    if (partition == NULL || partition->size < 2 * CAPTURE_LOG_SECTOR_SIZE) {
+        ESP_LOGE(CAPTURE_LOG_TAG, "Log partition not found");
+        return ESP_FAIL;
+    }
+    capture_log_resume();
+    capture_log_encoder_init(&encoder, block, sizeof(block));
+
+    // Create the queue and semaphore once, they are reused after a stop
+    if (record_queue == NULL) {
+        record_queue = xQueueCreate(CAPTURE_LOG_QUEUE_LENGTH, sizeof(capture_log_record_t));
+        done_semaphore = xSemaphoreCreateBinary();
+        if (record_queue == NULL || done_semaphore == NULL) {
+            ESP_LOGE(CAPTURE_LOG_TAG, "Failed to create queue");
+            return ESP_FAIL;
+        }
+    }
+
+    frames_enabled = log_frames;
+    dropped = 0;
+    running = true;
+    if (xTaskCreate(capture_log_task, "capture_log", 3072, NULL, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        ESP_LOGE(CAPTURE_LOG_TAG, "Failed to create task");
+        running = false;
+        return ESP_FAIL;
+    }
+    ESP_LOGI(CAPTURE_LOG_TAG, "Capture log started");
+    return ESP_OK;
+}
+
+// Write all buffered records and stop the writer task
+esp_err_t capture_log_stop(void){
+    if (!running) {
+        return ESP_OK;
+    }
+
+    running = false;
+    esp_err_t err = capture_log_send_marker(CAPTURE_LOG_STOP);
+    ESP_LOGI(CAPTURE_LOG_TAG, "Capture log stopped, %lu records dropped", (unsigned long)dropped);
+    return err;
+}
+
+// Write all buffered records to flash
+esp_err_t capture_log_flush(void){
+    if (!running) {
+        return ESP_FAIL;
+    }
+    return capture_log_send_marker(CAPTURE_LOG_FLUSH);
+}
+
+// Queue a record without blocking
+static void capture_log_append(const capture_log_record_t *record){
+    if (xQueueSend(record_queue, record, 0) != pdTRUE) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Log a device sighting
+void capture_log_sighting(const uint8_t *mac_addr, uint8_t channel, int8_t rssi, uint32_t frame_count, int64_t timestamp){
+    if (!running) {
+        return;
+    }
+
+    capture_log_record_t record = {
+        .type = CAPTURE_LOG_SIGHTING,
+        .channel = channel,
+        .rssi = rssi,
+        .frame_count = frame_count,
+        .timestamp_ms = (uint32_t)(timestamp / 1000)
+    };
+    memcpy(record.mac_addr, mac_addr, 6);
+    capture_log_append(&record);
+}
+
+// Log a frame summary if frame logging is enabled
+void capture_log_frame(const uint8_t *mac_addr, uint8_t channel, int8_t rssi, uint8_t frame_control, uint16_t length, int64_t timestamp){
+    if (!running || !frames_enabled) {
+        return;
+    }
+
+    capture_log_record_t record = {
+        .type = CAPTURE_LOG_FRAME,
+        .channel = channel,
+        .rssi = rssi,
+        .frame_control = frame_control,
+        .length = length,
+        .timestamp_ms = (uint32_t)(timestamp / 1000)
+    };
+    memcpy(record.mac_addr, mac_addr, 6);
+    capture_log_append(&record);
+}
+
+// Number of records dropped because the writer task fell behind or the flash failed
+uint32_t capture_log_dropped(void){
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,34 @@
+#ifndef CAPTURE_LOG_H
+#define CAPTURE_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "capture_log_codec.h"
+
+#define CAPTURE_LOG_TAG "CAPTURE_LOG"
+#define CAPTURE_LOG_PARTITION "capturelog"  // label of the data partition in partitions.csv
+#define CAPTURE_LOG_QUEUE_LENGTH 128        // records buffered between the capture path and the writer task
+#define CAPTURE_LOG_FLUSH_MS 10000          // maximum time a record waits in RAM before it is written
+#define CAPTURE_LOG_SIGHTING_MS 60000       // a device that stays is logged again in every period of this length
+#define CAPTURE_LOG_RETRY_MS 1000           // pause of the writer task after a flash error
+
+// Open the log partition and start the writer task, log_frames also logs a summary of every frame
+esp_err_t capture_log_start(bool log_frames);
+
+// Write all buffered records and stop the writer task
+esp_err_t capture_log_stop(void);
+
+// Write all buffered records to flash
+esp_err_t capture_log_flush(void);
+
+// Log a device sighting, never blocks so it can be called from the capture path
+void capture_log_sighting(const uint8_t *mac_addr, uint8_t channel, int8_t rssi, uint32_t frame_count, int64_t timestamp);
+
+// Log a frame summary if frame logging is enabled, never blocks
+void capture_log_frame(const uint8_t *mac_addr, uint8_t channel, int8_t rssi, uint8_t frame_control, uint16_t length, int64_t timestamp);
+
+// Number of records dropped because the writer task fell behind or the flash failed
+uint32_t capture_log_dropped(void);
+
+#endif // CAPTURE_LOG_H
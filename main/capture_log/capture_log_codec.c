@@ -0,0 +1,176 @@
+#include "capture_log_codec.h"
+#include <string.h>
+
+// Record tag byte
+#define TAG_FRAME 0x01          // record is a frame summary
+#define TAG_SAME_MAC 0x02       // MAC address equals the previous record's, omitted
+#define TAG_SAME_OUI 0x04       // OUI equals the previous record's, only the last 3 bytes follow
+#define TAG_CHANNEL_SHIFT 4
+
+// CRC-16/CCITT of a buffer
+uint16_t capture_log_crc16(const uint8_t *data, size_t length){
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Write an unsigned varint, returns the number of bytes written
+static uint8_t put_varint(uint8_t *buf, uint32_t value){
+    uint8_t len = 0;
+    while (value >= 0x80) {
+        buf[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buf[len++] = (uint8_t)value;
+    return len;
+}
+
+// Read an unsigned varint, returns false if it runs past the end of the block
+static bool get_varint(capture_log_decoder_t *decoder, uint32_t *value){
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (decoder->pos >= decoder->length) {
+            return false;
+        }
+        uint8_t byte = decoder->buf[decoder->pos++];
+        result |= (uint32_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Map signed deltas to small unsigned values
+static uint32_t zigzag(int32_t value){
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value){
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Start a new block in buf
+void capture_log_encoder_init(capture_log_encoder_t *encoder, uint8_t *buf, uint16_t capacity){
+    memset(encoder, 0, sizeof(capture_log_encoder_t));
+    encoder->buf = buf;
+    encoder->capacity = capacity;
+}
+
+// Append a record to the block
+bool capture_log_encode(capture_log_encoder_t *encoder, const capture_log_record_t *record){
+    if (encoder->length + CAPTURE_LOG_RECORD_MAX > encoder->capacity) {
+        return false;
+    }
+
+    // the first record sets the base of the block
+    if (encoder->count == 0) {
+        encoder->base_ms = record->timestamp_ms;
+        encoder->prev_ms = record->timestamp_ms;
+        encoder->prev_rssi = 0;
+        memset(encoder->prev_mac, 0, 6);
+    }
+
+    uint8_t *out = encoder->buf + encoder->length;
+    uint8_t len = 1;
+    uint8_t tag = (uint8_t)((record->channel & 0x0f) << TAG_CHANNEL_SHIFT);
+    if (record->type == CAPTURE_LOG_FRAME) {
+        tag |= TAG_FRAME;
+    }
+
+    len += put_varint(out + len, zigzag((int32_t)(record->timestamp_ms - encoder->prev_ms)));
+    len += put_varint(out + len, zigzag(record->rssi - encoder->prev_rssi));
+
+    // devices from the same vendor share the first half of their MAC address
+    if (encoder->count > 0 && memcmp(record->mac_addr, encoder->prev_mac, 6) == 0) {
+        tag |= TAG_SAME_MAC;
+    } else if (encoder->count > 0 && memcmp(record->mac_addr, encoder->prev_mac, 3) == 0) {
+        tag |= TAG_SAME_OUI;
+        memcpy(out + len, record->mac_addr + 3, 3);
+        len += 3;
+    } else {
+        memcpy(out + len, record->mac_addr, 6);
+        len += 6;
+    }
+
+    if (record->type == CAPTURE_LOG_FRAME) {
+        out[len++] = record->frame_control;
+        len += put_varint(out + len, record->length);
+    } else {
+        len += put_varint(out + len, record->frame_count);
+    }
+    out[0] = tag;
+
+    encoder->length += len;
+    encoder->count++;
+    encoder->prev_ms = record->timestamp_ms;
+    encoder->prev_rssi = record->rssi;
+    memcpy(encoder->prev_mac, record->mac_addr, 6);
+    return true;
+}
+
+// Start decoding a block payload
+void capture_log_decoder_init(capture_log_decoder_t *decoder, const uint8_t *buf, uint16_t length, uint32_t base_ms){
+    memset(decoder, 0, sizeof(capture_log_decoder_t));
+    decoder->buf = buf;
+    decoder->length = length;
+    decoder->prev_ms = base_ms;
+}
+
+// Decode the next record
+int capture_log_decode(capture_log_decoder_t *decoder, capture_log_record_t *record){
+    if (decoder->pos >= decoder->length) {
+        return 0;
+    }
+
+    memset(record, 0, sizeof(capture_log_record_t));
+    uint8_t tag = decoder->buf[decoder->pos++];
+    record->type = tag & TAG_FRAME ? CAPTURE_LOG_FRAME : CAPTURE_LOG_SIGHTING;
+    record->channel = tag >> TAG_CHANNEL_SHIFT;
+
+    uint32_t value;
+    if (!get_varint(decoder, &value)) {
+        return -1;
+    }
+    record->timestamp_ms = decoder->prev_ms + (uint32_t)unzigzag(value);
+    if (!get_varint(decoder, &value)) {
+        return -1;
+    }
+    record->rssi = (int8_t)(decoder->prev_rssi + unzigzag(value));
+
+    // restore the MAC address from the previous record when it was omitted
+    uint8_t mac_len = tag & TAG_SAME_MAC ? 0 : tag & TAG_SAME_OUI ? 3 : 6;
+    if (decoder->pos + mac_len > decoder->length) {
+        return -1;
+    }
+    memcpy(record->mac_addr, decoder->prev_mac, 6);
+    memcpy(record->mac_addr + 6 - mac_len, decoder->buf + decoder->pos, mac_len);
+    decoder->pos += mac_len;
+
+    if (record->type == CAPTURE_LOG_FRAME) {
+        if (decoder->pos >= decoder->length) {
+            return -1;
+        }
+        record->frame_control = decoder->buf[decoder->pos++];
+        if (!get_varint(decoder, &value)) {
+            return -1;
+        }
+        record->length = (uint16_t)value;
+    } else {
+        if (!get_varint(decoder, &value)) {
+            return -1;
+        }
+        record->frame_count = value;
+    }
+
+    decoder->prev_ms = record->timestamp_ms;
+    decoder->prev_rssi = record->rssi;
+    memcpy(decoder->prev_mac, record->mac_addr, 6);
+    return 1;
+}
@@ -0,0 +1,93 @@
+#ifndef CAPTURE_LOG_CODEC_H
+#define CAPTURE_LOG_CODEC_H
+
+// On-flash format of the capture log, shared with the host reader so it must not depend on ESP-IDF
+//
+// The log partition is a ring of sectors written in order. Each sector starts with a
+// capture_log_sector_header_t followed by blocks. A block is a capture_log_block_header_t and
+// a payload of delta/varint encoded records. Unwritten flash reads as 0xff, so a block
+// length of 0xffff marks the end of a sector.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CAPTURE_LOG_MAGIC 0x4c464e53    // "SNFL"
+#define CAPTURE_LOG_VERSION 1
+#define CAPTURE_LOG_SECTOR_SIZE 4096
+#define CAPTURE_LOG_BLOCK_SIZE 512      // maximum payload of a block
+#define CAPTURE_LOG_RECORD_MAX 20       // maximum encoded size of a record
+#define CAPTURE_LOG_BLOCK_UNWRITTEN 0xffff
+
+// Type of a log record
+typedef enum {
+    CAPTURE_LOG_SIGHTING = 0,   // a device was seen, frame_count holds its activity so far
+    CAPTURE_LOG_FRAME = 1       // summary of a single frame
+} capture_log_record_type_t;
+
+// Decoded log record
+typedef struct {
+    uint8_t type;               // capture_log_record_type_t
+    uint8_t channel;
+    int8_t rssi;
+    uint8_t frame_control;      // first frame control byte, frames only
+    uint16_t length;            // frame length, frames only
+    uint32_t frame_count;       // sightings only
+    uint32_t timestamp_ms;      // milliseconds since boot
+    uint8_t mac_addr[6];        // transmitter MAC address
+} capture_log_record_t;
+
+// Header at the start of every sector
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t sequence;          // increases by one for every sector written, orders the ring
+    uint16_t boot;              // boot the sector was written in, timestamps restart at every boot
+    uint8_t version;
+    uint8_t reserved[5];
+} capture_log_sector_header_t;
+
+// Header in front of every block, written after its payload
+typedef struct __attribute__((packed)) {
+    uint16_t length;            // payload length
+    uint16_t crc;               // CRC-16 of the payload
+    uint32_t base_ms;           // timestamp the first record is relative to
+} capture_log_block_header_t;
+
+// Block encoder
+typedef struct {
+    uint8_t *buf;
+    uint16_t capacity;
+    uint16_t length;
+    uint16_t count;
+    uint32_t base_ms;
+    uint32_t prev_ms;
+    int8_t prev_rssi;
+    uint8_t prev_mac[6];
+} capture_log_encoder_t;
+
+// Block decoder
+typedef struct {
+    const uint8_t *buf;
+    uint16_t length;
+    uint16_t pos;
+    uint32_t prev_ms;
+    int8_t prev_rssi;
+    uint8_t prev_mac[6];
+} capture_log_decoder_t;
+
+// CRC-16/CCITT of a buffer
+uint16_t capture_log_crc16(const uint8_t *data, size_t length);
+
+// Start a new block in buf
+void capture_log_encoder_init(capture_log_encoder_t *encoder, uint8_t *buf, uint16_t capacity);
+
+// Append a record to the block, returns false if the block is full
+bool capture_log_encode(capture_log_encoder_t *encoder, const capture_log_record_t *record);
+
+// Start decoding a block payload
+void capture_log_decoder_init(capture_log_decoder_t *decoder, const uint8_t *buf, uint16_t length, uint32_t base_ms);
+
+// Decode the next record, returns 1 on success, 0 at the end of the block and -1 on corrupt data
+int capture_log_decode(capture_log_decoder_t *decoder, capture_log_record_t *record);
+
+#endif // CAPTURE_LOG_CODEC_H
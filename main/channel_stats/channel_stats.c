@@ -0,0 +1,177 @@
+#include "channel_stats.h"
+#include <esp_log.h>
+#include <string.h>
+
+_Static_assert(CHANNEL_STATS_FOOTPRINT <= CHANNEL_STATS_MAX_FOOTPRINT, "channel stats exceed their memory budget");
+
+// Ring of buckets at one resolution
+typedef struct {
+    uint16_t length;        // number of buckets in the ring
+    uint16_t offset;        // offset of the ring in a channel's storage
+    int64_t unit_us;        // duration of a bucket
+} channel_stats_ring_t;
+
+// Position of a channel in one ring
+typedef struct {
+    uint32_t epoch;         // timestamp of the current bucket, in bucket units
+    uint16_t index;         // index of the current bucket
+    bool started;
+} channel_stats_cursor_t;
+
+static const channel_stats_ring_t rings[CHANNEL_STATS_RESOLUTIONS] = {
+    { CHANNEL_STATS_SECONDS, 0, 1000000LL },
+    { CHANNEL_STATS_MINUTES, CHANNEL_STATS_SECONDS, 60 * 1000000LL },
+    { CHANNEL_STATS_HOURS, CHANNEL_STATS_SECONDS + CHANNEL_STATS_MINUTES, 3600 * 1000000LL }
+};
+
+static channel_stats_bucket_t storage[CHANNEL_STATS_CHANNELS][CHANNEL_STATS_BUCKETS];
+static channel_stats_cursor_t cursors[CHANNEL_STATS_CHANNELS][CHANNEL_STATS_RESOLUTIONS];
+static uint32_t generation = 0;    // odd while the capture path is updating the rings
+
+// Non-HT PHY rates in units of 100 kbps, indexed by rate code
+static const uint16_t legacy_rates[16] = {
+    10, 20, 55, 110,        // DSSS long preamble
+    0, 20, 55, 110,         // DSSS short preamble
+    480, 240, 120, 60,      // OFDM
+    540, 360, 180, 90
+};
+
+// HT rates for 20 MHz channels and a long guard interval in units of 100 kbps, indexed by MCS % 8
+static const uint16_t ht_rates[8] = { 65, 130, 195, 260, 390, 520, 585, 650 };
+
+// Open and close an update of the rings so readers on other tasks can detect torn copies
+static inline void channel_stats_write_begin(void){
+    __atomic_store_n(&generation, generation + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void channel_stats_write_end(void){
+    __atomic_store_n(&generation, generation + 1, __ATOMIC_RELEASE);
+}
+
+// Move a channel's ring forward to the bucket holding timestamp, clearing skipped buckets
+static channel_stats_bucket_t *channel_stats_seek(uint8_t channel, channel_stats_resolution_t resolution, int64_t timestamp){
+    const channel_stats_ring_t *ring = &rings[resolution];
+    channel_stats_cursor_t *cursor = &cursors[channel][resolution];
+    channel_stats_bucket_t *buckets = &storage[channel][ring->offset];
+    uint32_t epoch = (uint32_t)(timestamp / ring->unit_us);
+
+    if (!cursor->started) {
+        cursor->started = true;
+        cursor->epoch = epoch;
+    } else if (epoch > cursor->epoch) {
+        // never clear more than the whole ring, even after a long idle period
+        uint32_t steps = epoch - cursor->epoch;
+        if (steps > ring->length) {
+            steps = ring->length;
+        }
+        while (steps-- > 0) {
+            cursor->index = (cursor->index + 1) % ring->length;
+            memset(&buckets[cursor->index], 0, sizeof(channel_stats_bucket_t));
+        }
+        cursor->epoch = epoch;
+    }
+    // late frames are credited to the current bucket
+
+    return &buckets[cursor->index];
+}
+
+// Record a received frame on a channel
+void channel_stats_record(uint8_t channel, int8_t rssi, uint32_t airtime_us, uint8_t new_devices, int64_t timestamp){
+    if (channel == 0 || channel > CHANNEL_STATS_CHANNELS) {
+        return;
+    }
+
+    channel_stats_write_begin();
+    for (int i = 0; i < CHANNEL_STATS_RESOLUTIONS; i++) {
+        channel_stats_bucket_t *bucket = channel_stats_seek(channel - 1, i, timestamp);
+        bucket->frames++;
+        bucket->airtime_us += airtime_us;
+        bucket->rssi_sum += rssi;
+        bucket->new_devices += new_devices;
+    }
+    channel_stats_write_end();
+}
+
+// Copy the last count buckets of a channel up to timestamp without touching the rings
+esp_err_t channel_stats_read(uint8_t channel, channel_stats_resolution_t resolution, uint16_t count,
+                             int64_t timestamp, channel_stats_bucket_t *buckets){
+    // Check input parameters
+    if (channel == 0 || channel > CHANNEL_STATS_CHANNELS || resolution >= CHANNEL_STATS_RESOLUTIONS ||
+        count == 0 || count > rings[resolution].length || buckets == NULL) {
+        ESP_LOGE(CHANNEL_STATS_TAG, "Invalid input parameters");
+        return ESP_FAIL;
+    }
+
+    const channel_stats_ring_t *ring = &rings[resolution];
+    const channel_stats_cursor_t *cursor = &cursors[channel - 1][resolution];
+    uint32_t epoch = (uint32_t)(timestamp / ring->unit_us);
+    channel_stats_cursor_t position;
+    uint32_t before, after;
+
+    // retry until no update of the rings overlapped the copy
+    do {
+        before = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+        position = *cursor;
+        // the window ends at the current bucket and may wrap around the end of the ring
+        const channel_stats_bucket_t *ring_buckets = &storage[channel - 1][ring->offset];
+        uint16_t first = (uint16_t)((position.index + 1 + ring->length - count) % ring->length);
+        uint16_t head = count < ring->length - first ? count : ring->length - first;
+        memcpy(buckets, &ring_buckets[first], head * sizeof(channel_stats_bucket_t));
+        memcpy(buckets + head, ring_buckets, (count - head) * sizeof(channel_stats_bucket_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&generation, __ATOMIC_RELAXED);
+    } while ((before & 1) != 0 || before != after);
+
+    // buckets the capture path has not reached yet saw no frames
+    if (!position.started) {
+        memset(buckets, 0, count * sizeof(channel_stats_bucket_t));
+    } else if (epoch > position.epoch) {
+        uint32_t idle = epoch - position.epoch;
+        if (idle >= count) {
+            memset(buckets, 0, count * sizeof(channel_stats_bucket_t));
+        } else {
+            memmove(buckets, buckets + idle, (count - idle) * sizeof(channel_stats_bucket_t));
+            memset(buckets + count - idle, 0, idle * sizeof(channel_stats_bucket_t));
+        }
+    }
+    return ESP_OK;
+}
+
+// Mean RSSI of a bucket
+int8_t channel_stats_mean_rssi(const channel_stats_bucket_t *bucket){
+    return bucket->frames == 0 ? 0 : (int8_t)(bucket->rssi_sum / (int32_t)bucket->frames);
+}
+
+// Estimate the airtime of a received frame from its rate and length
+uint32_t channel_stats_airtime_us(const wifi_pkt_rx_ctrl_t *rx_ctrl){
+    uint32_t rate;
+    uint32_t preamble_us;
+
+    if (rx_ctrl->sig_mode == 0) {
+        // non-HT frame, DSSS or OFDM
+        rate = legacy_rates[rx_ctrl->rate & 0x0f];
+        if (rate == 0) {
+            rate = 10;
+        }
+        preamble_us = rx_ctrl->rate < 4 ? 192 : rx_ctrl->rate < 8 ? 96 : 20;
+    } else {
+        // HT frame, 40 MHz channels carry a bit more than twice the data
+        rate = ht_rates[rx_ctrl->mcs % 8] * (rx_ctrl->mcs / 8 + 1);
+        if (rx_ctrl->cwb) {
+            rate = rate * 27 / 13;
+        }
+        preamble_us = 36;
+    }
+
+    // sig_len is in bytes and rate in units of 100 kbps
+    return preamble_us + (rx_ctrl->sig_len * 80 + rate - 1) / rate;
+}
+
+// Reset all time series
+void channel_stats_clear(void){
+    channel_stats_write_begin();
+    memset(storage, 0, sizeof(storage));
+    memset(cursors, 0, sizeof(cursors));
+    channel_stats_write_end();
+}
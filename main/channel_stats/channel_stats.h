@@ -0,0 +1,52 @@
+#ifndef CHANNEL_STATS_H
+#define CHANNEL_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_wifi_types.h>
+
+#define CHANNEL_STATS_TAG "CHANNEL_STATS"
+#define CHANNEL_STATS_CHANNELS 14
+#define CHANNEL_STATS_SECONDS 60        // number of 1 s buckets kept per channel
+#define CHANNEL_STATS_MINUTES 60        // number of 1 min buckets kept per channel
+#define CHANNEL_STATS_HOURS 24          // number of 1 h buckets kept per channel
+#define CHANNEL_STATS_MAX_FOOTPRINT (64 * 1024)
+
+// Resolution of a time series
+typedef enum {
+    CHANNEL_STATS_SECOND = 0,
+    CHANNEL_STATS_MINUTE,
+    CHANNEL_STATS_HOUR,
+    CHANNEL_STATS_RESOLUTIONS
+} channel_stats_resolution_t;
+
+// Activity of a channel during one time bucket
+typedef struct {
+    uint32_t frames;        // number of frames received
+    uint32_t airtime_us;    // estimated airtime of the received frames
+    int32_t rssi_sum;       // sum of the RSSI of the received frames, divide by frames for the mean
+    uint16_t new_devices;   // number of devices added to the channel's device list
+    uint16_t reserved;
+} channel_stats_bucket_t;
+
+#define CHANNEL_STATS_BUCKETS (CHANNEL_STATS_SECONDS + CHANNEL_STATS_MINUTES + CHANNEL_STATS_HOURS)
+#define CHANNEL_STATS_FOOTPRINT (CHANNEL_STATS_CHANNELS * CHANNEL_STATS_BUCKETS * sizeof(channel_stats_bucket_t))
+
+// Record a received frame on a channel, O(1)
+void channel_stats_record(uint8_t channel, int8_t rssi, uint32_t airtime_us, uint8_t new_devices, int64_t timestamp);
+
+// Copy the last count buckets of a channel up to timestamp (us), oldest first, safe from any task
+esp_err_t channel_stats_read(uint8_t channel, channel_stats_resolution_t resolution, uint16_t count,
+                             int64_t timestamp, channel_stats_bucket_t *buckets);
+
+// Mean RSSI of a bucket, 0 if no frames were received
+int8_t channel_stats_mean_rssi(const channel_stats_bucket_t *bucket);
+
+// Estimate the airtime (us) of a received frame from its rate and length
+uint32_t channel_stats_airtime_us(const wifi_pkt_rx_ctrl_t *rx_ctrl);
+
+// Reset all time series
+void channel_stats_clear(void);
+
+#endif // CHANNEL_STATS_H
@@ -1,43 +1,92 @@
 #include "deauth.h"
 #include "../device_list/device_list.h"
+#include "../channel_stats/channel_stats.h"
+#include "../capture_log/capture_log.h"
+#include "../seq_tracker/seq_tracker.h"
+#include "../radio/radio.h"
 #include <esp_err.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <esp_event.h>
 #include <esp_wifi.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <string.h>
 #include <freertos/FreeRTOS.h>
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 
 static bool device_lists_initialized = false;
 static u_int8_t current_channel;
 static device_list_t *device_lists[14];
 static u_int16_t ap_count = 0;
 static wifi_ap_record_t *ap_records = NULL;
+static SemaphoreHandle_t ap_records_mutex = NULL;   // ap_records grows from the radio task
 static TimerHandle_t deaut_timer;
 deauth_info_t *deauth_info = NULL;
 
-// Initialize the MAC lists
+// Initialize the MAC lists and the AP records lock
 static void device_lists_init() {
     for (int i = 0; i < 14; i++) {
         device_lists[i] = device_list_new(i + 1);
     }
+    ap_records_mutex = xSemaphoreCreateMutex();
     device_lists_initialized = true;
 }
 
+// Check that the radio manager does not own the driver before changing its mode
+static esp_err_t check_driver_free(void){
+    if (radio_is_initialized()) {
+        ESP_LOGE(DEAUTH_TAG, "The radio manager owns the driver, stop it with stop_radio_capture() first");
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
 // Promiscuous callback
 static void promiscuous_callback(void *buf, wifi_promiscuous_pkt_type_t type)
 {
     wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *)buf;
 
+    // file the frame under the channel it was received on, falling back to the tuned channel,
+    // frames received while the channel is unknown are dropped
+    uint8_t channel = pkt->rx_ctrl.channel;
+    if (channel == 0 || channel > 14) {
+        channel = radio_is_initialized() ? radio_get_channel() : current_channel;
+        if (channel == 0 || channel > 14) {
+            return;
+        }
+    }
+
+    // drop retransmissions before they are counted as new activity
+    if (seq_tracker_check(pkt->payload, pkt->rx_ctrl.sig_len)) {
+        return;
+    }
+
     uint8_t *src_addr = pkt->payload + 10; // Source address is at offset 10
     uint8_t *dst_addr = pkt->payload + 4;  // Destination address is at offset 4
 
-    // add the source & destination MAC address to the list
-    device_list_add(src_addr, device_lists[current_channel - 1]);
-    device_list_add(dst_addr, device_lists[current_channel - 1]);
+    device_list_t *device_list = device_lists[channel - 1];
+    uint32_t size = device_list->size;
+    int64_t now = esp_timer_get_time();
+
+    // add the source & destination MAC address to the list, only the source is credited with the frame
+    int64_t prev_seen;
+    const device_node_t *node = device_list_update(src_addr, pkt->rx_ctrl.rssi, now, &prev_seen, device_list);
+    device_list_add(dst_addr, device_list);
+
+    // update the channel's time series
+    channel_stats_record(channel, pkt->rx_ctrl.rssi, channel_stats_airtime_us(&pkt->rx_ctrl),
+                         device_list->size - size, now);
+
+    // log to flash, both calls return immediately when the capture log is not running;
+    // a device is logged when it is first heard and again in every sighting period it stays
+    int64_t sighting_us = (int64_t)CAPTURE_LOG_SIGHTING_MS * 1000;
+    if (node != NULL && (prev_seen == 0 || prev_seen / sighting_us != now / sighting_us)) {
+        capture_log_sighting(src_addr, channel, pkt->rx_ctrl.rssi, node->frame_count, now);
+    }
+    capture_log_frame(src_addr, channel, pkt->rx_ctrl.rssi, pkt->payload[0], pkt->rx_ctrl.sig_len, now);
 }
 
 // start sniffer, channel = 0 means all channels
@@ -52,6 +101,9 @@ esp_err_t start_sniffer(u_int8_t channel) {
     if (!device_lists_initialized) {
         device_lists_init();
     }
+    if (check_driver_free() != ESP_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
     // Set mode to WIFI_MODE_NULL
     if(esp_wifi_set_mode(WIFI_MODE_NULL) != ESP_OK) {
@@ -118,8 +170,67 @@ esp_err_t display_devices_info(u_int8_t channel){
     return ESP_OK;
 }
 
+// start a query over the devices of all channels, safe while capturing, release it with device_cursor_deinit()
+esp_err_t query_devices(device_cursor_t *cursor, const device_query_t *query){
+    // Initialize the MAC lists
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+
+    return device_cursor_init(cursor, device_lists, 14, query);
+}
+
+// device list of a channel, NULL for an invalid channel
+device_list_t *get_device_list(uint8_t channel){
+    if (channel == 0 || channel > 14) {
+        return NULL;
+    }
+    // Initialize the MAC lists
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+    return device_lists[channel - 1];
+}
+
+// number of devices in a channel, if channel = 0, in all channels
+uint32_t get_device_count(uint8_t channel){
+    if (channel > 14) {
+        return 0;
+    }
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+
+    if (channel != 0) {
+        return device_lists[channel - 1]->size;
+    }
+    uint32_t count = 0;
+    for (int i = 0; i < 14; i++) {
+        count += device_lists[i]->size;
+    }
+    return count;
+}
+
+// report device arrivals, departures and channel moves
+esp_err_t start_device_events(const device_events_config_t *config){
+    // Initialize the MAC lists
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+
+    return device_events_start(device_lists, 14, config);
+}
+
 // sniff all APs
 esp_err_t start_sniffer_AP(){
+    // Initialize the AP records lock
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+    if (check_driver_free() != ESP_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
     // Set mode to WIFI_MODE_STA
     if(esp_wifi_set_mode(WIFI_MODE_STA) != ESP_OK){
         ESP_LOGE(DEAUTH_TAG, "Failed to set wifi mode");
@@ -142,34 +253,118 @@ esp_err_t start_sniffer_AP(){
     ESP_LOGI(DEAUTH_TAG, "Scanning APs...");
 
     // get number of APs found
-    if(esp_wifi_scan_get_ap_num(&ap_count) != ESP_OK){
+    uint16_t count;
+    if(esp_wifi_scan_get_ap_num(&count) != ESP_OK){
         ESP_LOGE(DEAUTH_TAG, "Failed to get number of APs found");
         return ESP_FAIL;
     }
 
      // get all AP records
-    ap_records = malloc(sizeof(wifi_ap_record_t) * ap_count);
-    if(esp_wifi_scan_get_ap_records(&ap_count, ap_records) != ESP_OK){
+    wifi_ap_record_t *records = malloc(sizeof(wifi_ap_record_t) * (count ? count : 1));
+    if (records == NULL) {
+        ESP_LOGE(DEAUTH_TAG, "Failed to allocate memory for AP records");
+        return ESP_ERR_NO_MEM;
+    }
+    if(esp_wifi_scan_get_ap_records(&count, records) != ESP_OK){
         ESP_LOGE(DEAUTH_TAG, "Failed to get AP records");
+        free(records);
         return ESP_FAIL;
     }
-    ESP_LOGI(DEAUTH_TAG, "Number of APs found: %d", ap_count);	
+
+    // replace the records of the previous scan
+    xSemaphoreTake(ap_records_mutex, portMAX_DELAY);
+    wifi_ap_record_t *old_records = ap_records;
+    ap_records = records;
+    ap_count = count;
+    xSemaphoreGive(ap_records_mutex);
+    free(old_records);
+    ESP_LOGI(DEAUTH_TAG, "Number of APs found: %d", count);
 
     return ESP_OK;
 }
 
+// Merge the APs found by a radio scan slice into the AP records
+static void merge_AP_records(const wifi_ap_record_t *records, uint16_t count) {
+    xSemaphoreTake(ap_records_mutex, portMAX_DELAY);
+    for (uint16_t i = 0; i < count; i++) {
+        // update APs that are already known
+        int j = 0;
+        while (j < ap_count && memcmp(ap_records[j].bssid, records[i].bssid, 6) != 0) {
+            j++;
+        }
+        if (j == ap_count) {
+            wifi_ap_record_t *grown = realloc(ap_records, sizeof(wifi_ap_record_t) * (ap_count + 1));
+            if (grown == NULL) {
+                ESP_LOGE(DEAUTH_TAG, "Failed to allocate memory for AP records");
+                break;
+            }
+            ap_records = grown;
+            ap_count++;
+        }
+        ap_records[j] = records[i];
+    }
+    xSemaphoreGive(ap_records_mutex);
+}
+
+// capture on all channels with the radio manager, interleaving short AP scans without mode changes
+esp_err_t start_radio_capture(const radio_schedule_t *schedule){
+    // Initialize the MAC lists
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+
+    if (!radio_is_initialized()) {
+        esp_err_t err = radio_init(&promiscuous_callback, merge_AP_records);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return radio_start(schedule);
+}
+
+// stop capturing with the radio manager and hand the driver back
+esp_err_t stop_radio_capture(){
+    return radio_deinit();
+}
+
 // display all APs
 esp_err_t display_APs_info(){
+    // Initialize the AP records lock
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+
     // print AP records
+    xSemaphoreTake(ap_records_mutex, portMAX_DELAY);
 for (int i = 0; i < ap_count; i++) {
     ESP_LOGI("WIFI", "SSID: %s, RSSI: %d, Channel: %d, BSSID: %02x:%02x:%02x:%02x:%02x:%02x", 
         ap_records[i].ssid, ap_records[i].rssi, ap_records[i].primary,
         ap_records[i].bssid[0], ap_records[i].bssid[1], ap_records[i].bssid[2], 
         ap_records[i].bssid[3], ap_records[i].bssid[4], ap_records[i].bssid[5]);
 }
+    xSemaphoreGive(ap_records_mutex);
     return ESP_OK;
 }
 
+// copy up to max AP records starting at offset, returns the number copied
+uint16_t get_AP_records(wifi_ap_record_t *records, uint16_t offset, uint16_t max){
+    // Initialize the AP records lock
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+
+    xSemaphoreTake(ap_records_mutex, portMAX_DELAY);
+    uint16_t count = offset < ap_count ? ap_count - offset : 0;
+    if (count > max) {
+        count = max;
+    }
+    if (count > 0) {
+        memcpy(records, ap_records + offset, sizeof(wifi_ap_record_t) * count);
+    }
+    xSemaphoreGive(ap_records_mutex);
+    return count;
+}
+
 static void send_deauth_packet(TimerHandle_t xTimer) {
     uint8_t *AP_mac = deauth_info->AP_mac;
     uint8_t *target_mac = deauth_info->target_mac;
@@ -217,6 +412,14 @@ esp_err_t start_dos_attack(uint8_t *AP_mac, uint8_t *target_mac){
         return ESP_ERR_INVALID_ARG;
     }
 
+    // Initialize the AP records lock
+    if (!device_lists_initialized) {
+        device_lists_init();
+    }
+    if (check_driver_free() != ESP_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
     // Set mode to WIFI_MODE_STA
     if(esp_wifi_set_mode(WIFI_MODE_STA) != ESP_OK){
         ESP_LOGE(DEAUTH_TAG, "Failed to set wifi mode");
@@ -232,6 +435,7 @@ esp_err_t start_dos_attack(uint8_t *AP_mac, uint8_t *target_mac){
     }
 
     // loop through AP records to find the channel of the AP
+    xSemaphoreTake(ap_records_mutex, portMAX_DELAY);
     for (int i = 0; i < ap_count; i++) {
         if(memcmp(AP_mac, ap_records[i].bssid, 6) == 0){
             // set channel
@@ -239,6 +443,7 @@ esp_err_t start_dos_attack(uint8_t *AP_mac, uint8_t *target_mac){
             break;
         }
     }
+    xSemaphoreGive(ap_records_mutex);
     if (err != ESP_OK) {
         ESP_LOGE(DEAUTH_TAG, "Failed to set wifi channel");
         return err;
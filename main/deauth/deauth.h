@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 #include <esp_err.h>
+#include "../device_list/device_list.h"
+#include "../device_events/device_events.h"
+#include "../radio/radio.h"
 
 #define DEAUTH_TAG "DEAUTH"
 
@@ -17,12 +20,33 @@ esp_err_t start_sniffer(u_int8_t channel);
 // display all devices in a channel, if channel = 0, display all channels
 esp_err_t display_devices_info(u_int8_t channel);
 
+// start a query over the devices of all channels, safe while capturing, release it with device_cursor_deinit()
+esp_err_t query_devices(device_cursor_t *cursor, const device_query_t *query);
+
+// device list of a channel, NULL for an invalid channel
+device_list_t *get_device_list(uint8_t channel);
+
+// number of devices in a channel, if channel = 0, in all channels
+uint32_t get_device_count(uint8_t channel);
+
+// report device arrivals, departures and channel moves, subscribe with device_events_subscribe()
+esp_err_t start_device_events(const device_events_config_t *config);
+
 // sniff all APs
 esp_err_t start_sniffer_AP();
 
+// capture on all channels with the radio manager, interleaving short AP scans without mode changes
+esp_err_t start_radio_capture(const radio_schedule_t *schedule);
+
+// stop capturing with the radio manager
+esp_err_t stop_radio_capture();
+
 // display all APs
 esp_err_t display_APs_info();
 
+// copy up to max AP records starting at offset, returns the number copied
+uint16_t get_AP_records(wifi_ap_record_t *records, uint16_t offset, uint16_t max);
+
 // start DoS attack
 esp_err_t start_dos_attack(uint8_t *AP_mac, uint8_t *target_mac);
 
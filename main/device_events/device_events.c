@@ -0,0 +1,338 @@
+#include "device_events.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include "freertos/semphr.h"
+
+#define DEVICE_EVENTS_INDEX_MIN 64      // initial number of slots of the home index, a power of two
+
+ESP_EVENT_DEFINE_BASE(DEVICE_EVENTS);
+
+typedef struct {
+    device_event_cb_t callback;
+    void *ctx;
+} device_events_subscriber_t;
+
+// Copy of a device that was last reported, its home
+typedef struct {
+    device_node_t *node;        // NULL for a free slot
+    uint8_t channel;
+} device_events_home_t;
+
+static device_list_t *const *device_lists = NULL;
+static uint8_t device_list_count = 0;
+static device_events_config_t config;
+static esp_timer_handle_t sweep_timer = NULL;
+static SemaphoreHandle_t sweep_mutex = NULL;   // held by a sweep, so stopping waits for a running one
+static device_events_subscriber_t subscribers[DEVICE_EVENTS_MAX_SUBSCRIBERS];
+static uint32_t dropped = 0;
+
+// Open addressing index from MAC address to home, entries are replaced but never removed
+static device_events_home_t *homes = NULL;
+static size_t home_slots = 0;
+static size_t home_count = 0;
+
+// Preallocated queue, filled by a sweep and drained when the sweep ends
+static device_event_t queue[DEVICE_EVENTS_QUEUE_LENGTH];
+static size_t queue_length = 0;
+static size_t queued = 0;              // events queued by the current sweep
+
+static void device_events_dispatch(void);
+
+// Queue an event for a device, a full queue is delivered first so no change is lost
+static void device_events_queue(device_event_type_t type, const device_node_t *node, uint8_t channel, uint8_t prev_channel, int64_t now){
+    if (queue_length == DEVICE_EVENTS_QUEUE_LENGTH) {
+        device_events_dispatch();
+    }
+
+    queued++;
+    device_event_t *event = &queue[queue_length++];
+    event->type = type;
+    memcpy(event->mac_addr, node->mac_addr, 6);
+    event->channel = channel;
+    event->prev_channel = prev_channel;
+    event->rssi = node->rssi;
+    event->timestamp = now;
+}
+
+// Slot of a MAC address in the home index, either its entry or the free slot where it belongs
+static device_events_home_t *device_events_home_slot(device_events_home_t *table, size_t slots, const uint8_t *mac_addr){
+    // the low bytes of a MAC address are spread well enough, the OUI is not
+    uint32_t hash = ((uint32_t)mac_addr[2] << 24 | (uint32_t)mac_addr[3] << 16 | (uint32_t)mac_addr[4] << 8 | mac_addr[5]) * 0x9e3779b1u;
+    size_t mask = slots - 1;
+    for (size_t i = (hash ^ mac_addr[1]) & mask;; i = (i + 1) & mask) {
+        if (table[i].node == NULL || memcmp(table[i].node->mac_addr, mac_addr, 6) == 0) {
+            return &table[i];
+        }
+    }
+}
+
+// Home of a device, NULL if it was never reported
+static device_events_home_t *device_events_find_home(const uint8_t *mac_addr){
+    if (homes == NULL) {
+        return NULL;
+    }
+    device_events_home_t *home = device_events_home_slot(homes, home_slots, mac_addr);
+    return home->node != NULL ? home : NULL;
+}
+
+// Make a copy of a device its home, returns false if the index could not grow
+static bool device_events_set_home(device_node_t *node, uint8_t channel){
+    if (homes == NULL || (home_count + 1) * 4 > home_slots * 3) {
+        size_t slots = homes == NULL ? DEVICE_EVENTS_INDEX_MIN : home_slots * 2;
+        device_events_home_t *table = calloc(slots, sizeof(device_events_home_t));
+        if (table == NULL) {
+            ESP_LOGE(DEVICE_EVENTS_TAG, "Failed to grow the home index");
+            return false;
+        }
+        for (size_t i = 0; i < home_slots; i++) {
+            if (homes[i].node != NULL) {
+                *device_events_home_slot(table, slots, homes[i].node->mac_addr) = homes[i];
+            }
+        }
+        free(homes);
+        homes = table;
+        home_slots = slots;
+    }
+
+    device_events_home_t *home = device_events_home_slot(homes, home_slots, node->mac_addr);
+    if (home->node == NULL) {
+        home_count++;
+    }
+    home->node = node;
+    home->channel = channel;
+    return true;
+}
+
+// Report a debounced copy of a device, as new or as moved from its current home
+static void device_events_arrive(device_node_t *node, uint8_t channel, int64_t now){
+    device_events_home_t *home = device_events_find_home(node->mac_addr);
+    if (home != NULL && home->node == node) {
+        home = NULL;
+    }
+    bool moved = home != NULL && (home->node->flags & (DEVICE_FLAG_REPORTED | DEVICE_FLAG_GONE)) == DEVICE_FLAG_REPORTED;
+
+    // a device heard on overlapping channels stays home until its home copy has been
+    // silent for the debounce time while this copy was still heard
+    int64_t debounce_us = (int64_t)config.debounce_ms * 1000;
+    if (moved && node->last_seen - home->node->last_seen < debounce_us) {
+        return;
+    }
+
+    uint8_t prev_channel = 0;
+    if (moved) {
+        // the move replaces the departure event of the old channel
+        home->node->flags |= DEVICE_FLAG_GONE;
+        prev_channel = home->channel;
+    }
+    if (!device_events_set_home(node, channel)) {
+        return;
+    }
+    device_events_queue(moved ? DEVICE_EVENT_MOVED : DEVICE_EVENT_NEW, node, channel, prev_channel, now);
+    node->flags = DEVICE_FLAG_REPORTED;
+}
+
+// Deliver the queued events to the subscribers and the event loop
+static void device_events_dispatch(void){
+    for (size_t i = 0; i < queue_length; i++) {
+        for (int j = 0; j < DEVICE_EVENTS_MAX_SUBSCRIBERS; j++) {
+            if (subscribers[j].callback != NULL) {
+                subscribers[j].callback(&queue[i], subscribers[j].ctx);
+            }
+        }
+        if (config.post_to_event_loop &&
+            esp_event_post(DEVICE_EVENTS, queue[i].type, &queue[i], sizeof(device_event_t), 0) != ESP_OK) {
+            dropped++;
+        }
+    }
+    queue_length = 0;
+}
+
+// Compare the device lists against the reported state and queue the changes, with the sweep mutex held
+static void device_events_sweep_lists(int64_t now){
+
+    int64_t debounce_us = (int64_t)config.debounce_ms * 1000;
+    int64_t absence_us = (int64_t)config.absence_ms * 1000;
+    for (uint8_t i = 0; i < device_list_count; i++) {
+        device_list_t *device_list = device_lists[i];
+        if (device_list == NULL) {
+            continue;
+        }
+
+        for (device_node_t *node = device_list->head; node != NULL; node = node->next) {
+            // devices only seen as destination are never reported
+            if (node->frame_count == 0) {
+                continue;
+            }
+
+            bool present = now - node->last_seen < absence_us;
+            if ((node->flags & (DEVICE_FLAG_REPORTED | DEVICE_FLAG_GONE)) == DEVICE_FLAG_REPORTED) {
+                if (!present) {
+                    device_events_queue(DEVICE_EVENT_GONE, node, device_list->channel, 0, now);
+                    node->flags |= DEVICE_FLAG_GONE;
+                }
+                continue;
+            }
+            if (!present) {
+                continue;
+            }
+
+            if (node->flags & DEVICE_FLAG_GONE) {
+                // a home that left and came back is debounced again, a copy retired
+                // by a move stays retired until the device moves back to it
+                const device_events_home_t *home = device_events_find_home(node->mac_addr);
+                if (home == NULL || home->node == node ||
+                    (home->node->flags & (DEVICE_FLAG_REPORTED | DEVICE_FLAG_GONE)) != DEVICE_FLAG_REPORTED) {
+                    node->flags = 0;
+                    node->first_seen = node->last_seen;
+                    continue;
+                }
+            }
+
+            if (node->last_seen - node->first_seen >= debounce_us && node->frame_count >= config.min_frames) {
+                device_events_arrive(node, device_list->channel, now);
+            }
+        }
+    }
+
+}
+
+// Compare the device lists against the reported state and deliver the changes
+size_t device_events_sweep(int64_t now){
+    if (sweep_mutex == NULL || xSemaphoreTake(sweep_mutex, portMAX_DELAY) != pdTRUE) {
+        return 0;
+    }
+
+    queued = 0;
+    if (device_lists != NULL) {
+        device_events_sweep_lists(now);
+        device_events_dispatch();
+    }
+    size_t count = queued;
+    xSemaphoreGive(sweep_mutex);
+    return count;
+}
+
+// Periodic sweep
+static void device_events_timer(void *arg){
+    device_events_sweep(esp_timer_get_time());
+}
+
+// Start tracking changes in list_count device lists, nodes must not be removed from the lists until stopped
+esp_err_t device_events_start(device_list_t *const *lists, uint8_t list_count, const device_events_config_t *events_config){
+    // Check input parameters
+    if (lists == NULL || list_count == 0 || events_config == NULL) {
+        ESP_LOGE(DEVICE_EVENTS_TAG, "Invalid input parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sweep_timer != NULL) {
+        ESP_LOGE(DEVICE_EVENTS_TAG, "Device events already started");
+        return ESP_FAIL;
+    }
+
+    // Create the sweep mutex once, it is reused after a stop
+    if (sweep_mutex == NULL) {
+        sweep_mutex = xSemaphoreCreateMutex();
+        if (sweep_mutex == NULL) {
+            ESP_LOGE(DEVICE_EVENTS_TAG, "Failed to create mutex");
+            return ESP_FAIL;
+        }
+    }
+
+    // the home index starts empty, so no device may keep a report from a previous run
+    for (uint8_t i = 0; i < list_count; i++) {
+        for (device_node_t *node = lists[i] != NULL ? lists[i]->head : NULL; node != NULL; node = node->next) {
+            node->flags = 0;
+        }
+    }
+
+    device_lists = lists;
+    device_list_count = list_count;
+    config = *events_config;
+    queue_length = 0;
+    dropped = 0;
+    if (config.interval_ms == 0) {
+        return ESP_OK;
+    }
+
+    // Create the periodic sweep timer
+    const esp_timer_create_args_t timer_args = {
+        .callback = device_events_timer,
+        .name = "device_events"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &sweep_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(DEVICE_EVENTS_TAG, "Failed to create timer");
+        return err;
+    }
+    err = esp_timer_start_periodic(sweep_timer, (uint64_t)config.interval_ms * 1000);
+    if (err != ESP_OK) {
+        ESP_LOGE(DEVICE_EVENTS_TAG, "Failed to start timer");
+        esp_timer_delete(sweep_timer);
+        sweep_timer = NULL;
+        return err;
+    }
+    ESP_LOGI(DEVICE_EVENTS_TAG, "Device events started");
+    return ESP_OK;
+}
+
+// Stop the periodic sweep
+esp_err_t device_events_stop(void){
+    if (sweep_mutex == NULL) {
+        return ESP_OK;
+    }
+
+    // no sweep starts after the timer is stopped, wait for one that is running
+    if (sweep_timer != NULL) {
+        esp_timer_stop(sweep_timer);
+    }
+    xSemaphoreTake(sweep_mutex, portMAX_DELAY);
+    if (sweep_timer != NULL) {
+        esp_timer_delete(sweep_timer);
+        sweep_timer = NULL;
+    }
+    device_lists = NULL;
+    device_list_count = 0;
+    free(homes);
+    homes = NULL;
+    home_slots = 0;
+    home_count = 0;
+    xSemaphoreGive(sweep_mutex);
+    ESP_LOGI(DEVICE_EVENTS_TAG, "Device events stopped");
+    return ESP_OK;
+}
+
+// Add a subscriber callback
+esp_err_t device_events_subscribe(device_event_cb_t callback, void *ctx){
+    if (callback == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < DEVICE_EVENTS_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].callback == NULL) {
+            subscribers[i].callback = callback;
+            subscribers[i].ctx = ctx;
+            return ESP_OK;
+        }
+    }
+    ESP_LOGE(DEVICE_EVENTS_TAG, "Too many subscribers");
+    return ESP_ERR_NO_MEM;
+}
+
+// Remove a subscriber callback
+esp_err_t device_events_unsubscribe(device_event_cb_t callback, void *ctx){
+    for (int i = 0; i < DEVICE_EVENTS_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].callback == callback && subscribers[i].ctx == ctx) {
+            subscribers[i].callback = NULL;
+            subscribers[i].ctx = NULL;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// Number of events the default event loop did not accept
+uint32_t device_events_dropped(void){
+    return dropped;
+}
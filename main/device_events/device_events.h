@@ -0,0 +1,72 @@
+#ifndef DEVICE_EVENTS_H
+#define DEVICE_EVENTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include <esp_event.h>
+#include "../device_list/device_list.h"
+
+#define DEVICE_EVENTS_TAG "DEVICE_EVENTS"
+#define DEVICE_EVENTS_QUEUE_LENGTH 64       // events buffered before delivery, a full queue is delivered mid-sweep
+#define DEVICE_EVENTS_MAX_SUBSCRIBERS 4
+
+ESP_EVENT_DECLARE_BASE(DEVICE_EVENTS);
+
+// Type of a device event, also used as the event id on the event loop
+typedef enum {
+    DEVICE_EVENT_NEW = 0,       // a device has been seen over the debounce time
+    DEVICE_EVENT_GONE,          // a device was not seen for the absence timeout
+    DEVICE_EVENT_MOVED          // a reported device was heard on another channel for the debounce
+                                // time after its old channel went silent
+} device_event_type_t;
+
+typedef struct {
+    device_event_type_t type;
+    uint8_t mac_addr[6];
+    uint8_t channel;            // channel the device is on, or was last seen on for DEVICE_EVENT_GONE
+    uint8_t prev_channel;       // channel the device left, DEVICE_EVENT_MOVED only
+    int8_t rssi;                // last RSSI of the device
+    int64_t timestamp;          // timestamp (us) of the sweep that detected the change
+} device_event_t;
+
+// Subscriber callback, called from the sweep context, must not call device_events_stop()
+typedef void (*device_event_cb_t)(const device_event_t *event, void *ctx);
+
+typedef struct {
+    uint32_t debounce_ms;       // a device is reported once it has been seen over this long
+    uint32_t min_frames;        // and sent at least this many frames
+    uint32_t absence_ms;        // a reported device not seen for this long is gone
+    uint32_t interval_ms;       // period of the sweep, 0 to only sweep from device_events_sweep()
+    bool post_to_event_loop;    // also post events to the default event loop
+} device_events_config_t;
+
+#define DEVICE_EVENTS_DEFAULT_CONFIG() {    \
+    .debounce_ms = 10000,                   \
+    .min_frames = 2,                        \
+    .absence_ms = 300000,                   \
+    .interval_ms = 5000,                    \
+    .post_to_event_loop = false             \
+}
+
+// Start tracking changes in list_count device lists, nodes must not be removed from the lists until stopped.
+// Devices reported in a previous run are reported again.
+esp_err_t device_events_start(device_list_t *const *lists, uint8_t list_count, const device_events_config_t *config);
+
+// Stop the periodic sweep, waits for a sweep that is running
+esp_err_t device_events_stop(void);
+
+// Add a subscriber callback
+esp_err_t device_events_subscribe(device_event_cb_t callback, void *ctx);
+
+// Remove a subscriber callback
+esp_err_t device_events_unsubscribe(device_event_cb_t callback, void *ctx);
+
+// Compare the device lists against the reported state and deliver the changes, returns the number of events
+size_t device_events_sweep(int64_t now);
+
+// Number of events the default event loop did not accept
+uint32_t device_events_dropped(void);
+
+#endif // DEVICE_EVENTS_H
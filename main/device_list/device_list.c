@@ -1,6 +1,9 @@
 #include "device_list.h"
 #include <esp_log.h>
 #include <string.h>
+#include <stdlib.h>
+
+static esp_err_t device_list_merge(const device_node_t *node, device_list_t *device_list);
 
 // Constructor for device_list_t
 device_list_t *device_list_new(uint8_t channel){
@@ -32,7 +35,7 @@ device_list_t *device_list_new_combine(const device_list_t *device_list1, ...){
     // Add all MAC mac_addresses from the first list
     device_node_t *curr_node = device_list1->head;
     while (curr_node != NULL) {
-        device_list_add(curr_node->mac_addr, device_list);
+        device_list_merge(curr_node, device_list);
         curr_node = curr_node->next;
     }
 
@@ -43,7 +46,7 @@ device_list_t *device_list_new_combine(const device_list_t *device_list1, ...){
     while (curr_device_list != NULL) {
         curr_node = curr_device_list->head;
         while (curr_node != NULL) {
-            device_list_add(curr_node->mac_addr, device_list);
+            device_list_merge(curr_node, device_list);
             curr_node = curr_node->next;
         }
         curr_device_list = va_arg(args, device_list_t *);
@@ -71,6 +74,60 @@ esp_err_t device_list_destroy(device_list_t *device_list){
     return ESP_OK;
 }
 
+// Append a new device to the linked list, the caller checks for duplicates
+static device_node_t *device_list_append(const uint8_t *mac_addr, device_list_t *device_list){
+    // Create a new device
+    device_node_t *new_node = malloc(sizeof(device_node_t));
+    if (new_node == NULL) {
+        ESP_LOGE(DEVICE_LIST_TAG, "Failed to allocate memory for new device");
+        return NULL;
+    }
+    memcpy(new_node->mac_addr, mac_addr, 6);
+    new_node->rssi = 0;
+    new_node->frame_count = 0;
+    new_node->first_seen = 0;
+    new_node->last_seen = 0;
+    new_node->flags = 0;
+    new_node->next = NULL;
+    device_list->size++;
+
+    // Add the new device to the list, published last so a concurrent cursor never sees it half initialized
+    if (device_list->head == NULL) {
+        __atomic_store_n(&device_list->head, new_node, __ATOMIC_RELEASE);
+    } else {
+        device_node_t *curr_node = device_list->head;
+        while (curr_node->next != NULL) {
+            curr_node = curr_node->next;
+        }
+        __atomic_store_n(&curr_node->next, new_node, __ATOMIC_RELEASE);
+    }
+
+    return new_node;
+}
+
+// Add a device to the linked list, merging its info if it is already in the list
+static esp_err_t device_list_merge(const device_node_t *node, device_list_t *device_list){
+    device_node_t *curr_node = device_list_find(node->mac_addr, device_list);
+    if (curr_node == NULL) {
+        curr_node = device_list_append(node->mac_addr, device_list);
+        if (curr_node == NULL) {
+            return ESP_FAIL;
+        }
+    }
+
+    // Keep the earliest first sighting, the most recent RSSI and sum the activity
+    if (node->frame_count != 0 && (curr_node->frame_count == 0 || node->first_seen < curr_node->first_seen)) {
+        curr_node->first_seen = node->first_seen;
+    }
+    if (curr_node->frame_count == 0 || node->last_seen > curr_node->last_seen) {
+        curr_node->rssi = node->rssi;
+        curr_node->last_seen = node->last_seen;
+    }
+    curr_node->frame_count += node->frame_count;
+
+    return ESP_OK;
+}
+
 // Add a device using a MAC mac_address to the linked list
 esp_err_t device_list_add(const uint8_t *mac_addr, device_list_t *device_list){
     // Check input parameters
@@ -85,28 +142,35 @@ esp_err_t device_list_add(const uint8_t *mac_addr, device_list_t *device_list){
         return ESP_OK;
     }
 
-    // Create a new device
-    device_node_t *new_node = malloc(sizeof(device_node_t));
-    if (new_node == NULL) {
-        ESP_LOGE(DEVICE_LIST_TAG, "Failed to allocate memory for new device");
-        return ESP_FAIL;
+    return device_list_append(mac_addr, device_list) == NULL ? ESP_FAIL : ESP_OK;
+}
+
+// Add or refresh a device using a MAC mac_address, recording the RSSI and timestamp of its frame
+device_node_t *device_list_update(const uint8_t *mac_addr, int8_t rssi, int64_t timestamp, int64_t *prev_seen, device_list_t *device_list){
+    // Check input parameters
+    if (mac_addr == NULL || device_list == NULL) {
+        ESP_LOGE(DEVICE_LIST_TAG, "Invalid input parameters");
+        return NULL;
     }
-    memcpy(new_node->mac_addr, mac_addr, 6);
-    new_node->next = NULL;
-    device_list->size++;
 
-    // Add the new device to the list
-    if (device_list->head == NULL) {
-        device_list->head = new_node;
-    } else {
-        device_node_t *curr_node = device_list->head;
-        while (curr_node->next != NULL) {
-            curr_node = curr_node->next;
+    device_node_t *node = device_list_find(mac_addr, device_list);
+    if (node == NULL) {
+        node = device_list_append(mac_addr, device_list);
+        if (node == NULL) {
+            return NULL;
         }
-        curr_node->next = new_node;
     }
 
-    return ESP_OK;
+    if (node->frame_count == 0) {
+        node->first_seen = timestamp;
+    }
+    if (prev_seen != NULL) {
+        *prev_seen = node->frame_count == 0 ? 0 : node->last_seen;
+    }
+    node->rssi = rssi;
+    node->last_seen = timestamp;
+    node->frame_count++;
+    return node;
 }
 
 // Remove a device using MAC mac_address from the linked list
@@ -167,7 +231,7 @@ esp_err_t device_list_clear(device_list_t *device_list){
 }
 
 // Get all the MAC mac_addresses from the linked list
-esp_err_t get_mac_mac_addresses(const device_list_t *device_list, uint8_t *mac_addr, const uint32_t *size){
+esp_err_t get_mac_addresses(const device_list_t *device_list, uint8_t *mac_addr, const uint32_t *size){
     if (device_list == NULL || mac_addr == NULL || size == NULL) {
         ESP_LOGE(DEVICE_LIST_TAG, "Invalid input parameters");
         return ESP_FAIL;
@@ -194,13 +258,213 @@ esp_err_t get_mac_mac_addresses(const device_list_t *device_list, uint8_t *mac_a
 // Print all devices info in the linked list
 esp_err_t device_list_print(const device_list_t *device_list){
     device_node_t *curr_node = device_list->head;
-    ESP_LOGI(DEVICE_LIST_TAG, "Device list size: %lu, channel: %d", device_list->size, device_list->channel);
+    ESP_LOGI(DEVICE_LIST_TAG, "Device list size: %lu, channel: %d", (unsigned long)device_list->size, device_list->channel);
     while(curr_node != NULL){
-        ESP_LOGI(DEVICE_LIST_TAG, "\t\t%02x:%02x:%02x:%02x:%02x:%02x",
+        ESP_LOGI(DEVICE_LIST_TAG, "\t\t%02x:%02x:%02x:%02x:%02x:%02x, RSSI: %d, frames: %lu",
                  curr_node->mac_addr[0], curr_node->mac_addr[1], curr_node->mac_addr[2],
-                 curr_node->mac_addr[3], curr_node->mac_addr[4], curr_node->mac_addr[5]);
+                 curr_node->mac_addr[3], curr_node->mac_addr[4], curr_node->mac_addr[5],
+                 curr_node->rssi, (unsigned long)curr_node->frame_count);
         curr_node = curr_node->next;
     }
 
     return ESP_OK;
 }
+
+// Check if a device on a channel matches a query
+bool device_query_match(const device_query_t *query, const device_node_t *node, uint8_t channel){
+    if (query->channel != 0 && query->channel != channel) {
+        return false;
+    }
+    if (query->seen_after != 0 && node->last_seen < query->seen_after) {
+        return false;
+    }
+    if (query->seen_before != 0 && node->last_seen >= query->seen_before) {
+        return false;
+    }
+    // devices only seen as destination have no RSSI
+    if (query->min_rssi != 0 && (node->frame_count == 0 || node->rssi < query->min_rssi)) {
+        return false;
+    }
+    if (query->match_oui && memcmp(node->mac_addr, query->oui, 3) != 0) {
+        return false;
+    }
+    if (query->predicate != NULL && !query->predicate(node, channel, query->predicate_ctx)) {
+        return false;
+    }
+    return true;
+}
+
+// Copy a node the capture path may be updating, so its fields are consistent
+void device_node_snapshot(const device_node_t *node, device_node_t *snapshot){
+    // the capture path updates last_seen and frame_count last, a copy taken while they
+    // did not change is consistent; 64-bit timestamps are two stores on the target
+    const volatile device_node_t *live = node;
+    do {
+        memcpy(snapshot, node, sizeof(device_node_t));
+    } while (snapshot->last_seen != live->last_seen || snapshot->frame_count != live->frame_count);
+}
+
+// Sort key of a device for an ordered query, larger keys come first
+static int64_t device_cursor_key(const device_cursor_t *cursor, const device_node_t *node){
+    // a key torn by a concurrent update only misplaces the device in its page, it is still returned once
+    return cursor->query.order == DEVICE_ORDER_LAST_SEEN ? node->last_seen : (int64_t)node->frame_count;
+}
+
+// Compare two devices in query order, negative if a comes before b
+static int device_cursor_compare(int64_t key_a, uint8_t channel_a, const uint8_t *mac_a,
+                                 int64_t key_b, uint8_t channel_b, const uint8_t *mac_b){
+    if (key_a != key_b) {
+        return key_a > key_b ? -1 : 1;
+    }
+    if (channel_a != channel_b) {
+        return channel_a < channel_b ? -1 : 1;
+    }
+    return memcmp(mac_a, mac_b, 6);
+}
+
+// Initialize a cursor over list_count device lists
+esp_err_t device_cursor_init(device_cursor_t *cursor, device_list_t *const *lists, uint8_t list_count, const device_query_t *query){
+    if (cursor == NULL || (lists == NULL && list_count != 0)) {
+        ESP_LOGE(DEVICE_LIST_TAG, "Invalid input parameters");
+        return ESP_FAIL;
+    }
+
+    memset(cursor, 0, sizeof(device_cursor_t));
+    cursor->lists = lists;
+    cursor->list_count = list_count;
+    if (query != NULL) {
+        cursor->query = *query;
+    }
+    cursor->node = list_count != 0 && lists[0] != NULL ? __atomic_load_n(&lists[0]->head, __ATOMIC_ACQUIRE) : NULL;
+    if (cursor->query.order == DEVICE_ORDER_NONE || list_count == 0) {
+        return ESP_OK;
+    }
+
+    // ordered cursors remember which of the devices present now they returned, one bit each
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < list_count; i++) {
+        total += lists[i] != NULL ? lists[i]->size : 0;
+    }
+    cursor->sizes = calloc(list_count + (total + 31) / 32, sizeof(uint32_t));
+    if (cursor->sizes == NULL) {
+        ESP_LOGE(DEVICE_LIST_TAG, "Failed to allocate memory for cursor");
+        return ESP_ERR_NO_MEM;
+    }
+    cursor->returned = cursor->sizes + list_count;
+    for (uint8_t i = 0; i < list_count; i++) {
+        cursor->sizes[i] = lists[i] != NULL ? lists[i]->size : 0;
+    }
+    return ESP_OK;
+}
+
+// Release the memory of a cursor
+void device_cursor_deinit(device_cursor_t *cursor){
+    if (cursor == NULL) {
+        return;
+    }
+    free(cursor->sizes);
+    cursor->sizes = NULL;
+    cursor->returned = NULL;
+    cursor->list_index = cursor->list_count;
+}
+
+// Walk the lists in table order
+static size_t device_cursor_next_page_unordered(device_cursor_t *cursor, device_entry_t *entries, size_t max){
+    size_t count = 0;
+    while (count < max && cursor->list_index < cursor->list_count) {
+        const device_list_t *device_list = cursor->lists[cursor->list_index];
+        if (cursor->node == NULL) {
+            // move to the next list
+            cursor->list_index++;
+            if (cursor->list_index < cursor->list_count && cursor->lists[cursor->list_index] != NULL) {
+                cursor->node = __atomic_load_n(&cursor->lists[cursor->list_index]->head, __ATOMIC_ACQUIRE);
+            }
+            continue;
+        }
+        if (device_query_match(&cursor->query, cursor->node, device_list->channel)) {
+            entries[count].node = cursor->node;
+            entries[count].channel = device_list->channel;
+            entries[count].position = 0;
+            count++;
+        }
+        cursor->node = __atomic_load_n(&cursor->node->next, __ATOMIC_ACQUIRE);
+    }
+    return count;
+}
+
+// Select the next page in query order with one pass over the devices not returned yet, keeping the page sorted
+static size_t device_cursor_next_page_ordered(device_cursor_t *cursor, device_entry_t *entries, size_t max){
+    size_t count = 0;
+    uint32_t base = 0;
+    for (uint8_t i = 0; i < cursor->list_count; base += cursor->sizes[i], i++) {
+        const device_list_t *device_list = cursor->lists[i];
+        if (device_list == NULL) {
+            continue;
+        }
+
+        // devices appended after device_cursor_init() are left out
+        const device_node_t *node = __atomic_load_n(&device_list->head, __ATOMIC_ACQUIRE);
+        const uint32_t *returned = cursor->returned;
+        uint32_t end = base + cursor->sizes[i];
+        for (uint32_t position = base; position < end && node != NULL;
+             position++, node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) {
+            if (returned[position / 32] >> (position % 32) & 1) {
+                continue;
+            }
+            if (!device_query_match(&cursor->query, node, device_list->channel)) {
+                continue;
+            }
+
+            // find the insert position, dropping the device if it falls behind a full page
+            int64_t key = device_cursor_key(cursor, node);
+            size_t pos = count;
+            while (pos > 0 && device_cursor_compare(key, device_list->channel, node->mac_addr,
+                    device_cursor_key(cursor, entries[pos - 1].node), entries[pos - 1].channel,
+                    entries[pos - 1].node->mac_addr) < 0) {
+                pos--;
+            }
+            if (pos == max) {
+                continue;
+            }
+            if (count < max) {
+                count++;
+            }
+            memmove(&entries[pos + 1], &entries[pos], (count - 1 - pos) * sizeof(device_entry_t));
+            entries[pos].node = node;
+            entries[pos].channel = device_list->channel;
+            entries[pos].position = position;
+        }
+    }
+
+    // mark the page returned
+    for (size_t i = 0; i < count; i++) {
+        cursor->returned[entries[i].position / 32] |= 1u << (entries[i].position % 32);
+    }
+    if (count == 0) {
+        cursor->list_index = cursor->list_count;
+    }
+    return count;
+}
+
+// Fill up to max entries with the next matching devices
+size_t device_cursor_next_page(device_cursor_t *cursor, device_entry_t *entries, size_t max){
+    if (cursor == NULL || entries == NULL || max == 0) {
+        return 0;
+    }
+
+    // ordered cursors are exhausted once a pass returned nothing
+    if (cursor->list_index >= cursor->list_count ||
+        (cursor->query.order != DEVICE_ORDER_NONE && cursor->sizes == NULL)) {
+        return 0;
+    }
+
+    if (cursor->query.order == DEVICE_ORDER_NONE) {
+        return device_cursor_next_page_unordered(cursor, entries, max);
+    }
+    return device_cursor_next_page_ordered(cursor, entries, max);
+}
+
+// Get the next matching device
+bool device_cursor_next(device_cursor_t *cursor, device_entry_t *entry){
+    return device_cursor_next_page(cursor, entry, 1) == 1;
+}
@@ -2,15 +2,24 @@
 #define DEVICE_LIST_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <esp_err.h>
 #include <stdbool.h>
 #include <stdarg.h>
 
 #define DEVICE_LIST_TAG "DEVICE_LIST"
 
+#define DEVICE_FLAG_REPORTED 0x01    // arrival of the device was reported
+#define DEVICE_FLAG_GONE 0x02        // departure of the device was reported
+
 // Linked list node for storing devices
 typedef struct device_node_t{
     uint8_t mac_addr[6];    // unique MAC address
+    int8_t rssi;            // RSSI of the last frame sent by the device
+    uint32_t frame_count;   // number of frames sent by the device
+    int64_t first_seen;     // timestamp (us) of the first frame sent by the device
+    int64_t last_seen;      // timestamp (us) of the last frame sent by the device
+    uint8_t flags;          // DEVICE_FLAG_* state owned by the event tracker
     struct device_node_t *next;
 } device_node_t;
 
@@ -21,6 +30,49 @@ typedef struct device_list_t{
     uint8_t channel;
 } device_list_t;
 
+// Secondary ordering of a device query
+typedef enum {
+    DEVICE_ORDER_NONE = 0,      // table order, O(1) per step
+    DEVICE_ORDER_LAST_SEEN,     // most recently seen first, one table pass per page
+    DEVICE_ORDER_ACTIVITY       // highest frame count first, one table pass per page
+} device_order_t;
+
+// Caller supplied predicate, return true to keep the device
+typedef bool (*device_predicate_t)(const device_node_t *node, uint8_t channel, void *ctx);
+
+// Query over one or more device lists, a zero-initialized query matches every device
+typedef struct {
+    uint8_t channel;                // only devices on this channel, 0 = all channels
+    int64_t seen_after;             // only devices seen at or after this timestamp (us), 0 = no bound
+    int64_t seen_before;            // only devices seen before this timestamp (us), 0 = no bound
+    int8_t min_rssi;                // only devices with at least this RSSI, 0 = no threshold
+    bool match_oui;                 // only devices whose MAC address starts with oui
+    uint8_t oui[3];
+    device_predicate_t predicate;   // optional extra predicate
+    void *predicate_ctx;
+    device_order_t order;
+} device_query_t;
+
+// Device returned by a cursor, points into the live table, read it with device_node_snapshot()
+typedef struct {
+    const device_node_t *node;
+    uint8_t channel;
+    uint32_t position;              // ordered: index of the device among those present at device_cursor_init()
+} device_entry_t;
+
+// Cursor walking device lists in place. The capture path may append and update nodes while it is in use,
+// but nodes must not be removed. An ordered cursor returns the devices present when it was initialized,
+// each exactly once, even if their sort keys change between pages.
+typedef struct {
+    device_list_t *const *lists;
+    uint8_t list_count;
+    device_query_t query;
+    uint8_t list_index;             // DEVICE_ORDER_NONE: list of the next node, list_count once exhausted
+    const device_node_t *node;      // DEVICE_ORDER_NONE: next node to visit
+    uint32_t *sizes;                // ordered: size of each list at device_cursor_init()
+    uint32_t *returned;             // ordered: bitmap of the positions already returned, shares the sizes allocation
+} device_cursor_t;
+
 // Constructor for device_list_t
 device_list_t *device_list_new(uint8_t channel);
 
@@ -33,6 +85,10 @@ esp_err_t device_list_destroy(device_list_t *device_list);
 // Add a device using a MAC address to the linked list
 esp_err_t device_list_add(const uint8_t *mac_addr, device_list_t *device_list);
 
+// Add or refresh a device using a MAC address, recording the RSSI and timestamp (us) of its frame,
+// returns its node or NULL, prev_seen (optional) gets the timestamp of its previous frame or 0
+device_node_t *device_list_update(const uint8_t *mac_addr, int8_t rssi, int64_t timestamp, int64_t *prev_seen, device_list_t *device_list);
+
 // Remove a device using MAC address from the linked list
 esp_err_t device_list_remove(const uint8_t *mac_addr, device_list_t *device_list);
 
@@ -51,4 +107,22 @@ esp_err_t get_mac_addresses(const device_list_t *device_list, uint8_t *mac_addr,
 // Print all devices info in the linked list
 esp_err_t device_list_print(const device_list_t *device_list);
 
+// Copy a node the capture path may be updating, so its fields are consistent
+void device_node_snapshot(const device_node_t *node, device_node_t *snapshot);
+
+// Check if a device on a channel matches a query
+bool device_query_match(const device_query_t *query, const device_node_t *node, uint8_t channel);
+
+// Initialize a cursor over list_count device lists, release it with device_cursor_deinit()
+esp_err_t device_cursor_init(device_cursor_t *cursor, device_list_t *const *lists, uint8_t list_count, const device_query_t *query);
+
+// Release the memory of a cursor
+void device_cursor_deinit(device_cursor_t *cursor);
+
+// Get the next matching device, returns false when the cursor is exhausted
+bool device_cursor_next(device_cursor_t *cursor, device_entry_t *entry);
+
+// Fill up to max entries with the next matching devices, returns the number of entries filled
+size_t device_cursor_next_page(device_cursor_t *cursor, device_entry_t *entries, size_t max);
+
 #endif // DEVICE_LIST_H
\ No newline at end of file
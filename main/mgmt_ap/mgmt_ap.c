@@ -0,0 +1,164 @@
+#include "mgmt_ap.h"
+#include "stats_json.h"
+#include "../softAP/softAP.h"
+#include "../radio/radio.h"
+#include <esp_http_server.h>
+#include <esp_log.h>
+#include <stdlib.h>
+#include <string.h>
+
+static httpd_handle_t server = NULL;
+
+// Parsed query of a /devices request
+typedef struct {
+    device_query_t query;
+    uint32_t limit;
+} devices_request_t;
+
+// Pass a rendered chunk to the HTTP response
+static esp_err_t mgmt_ap_sink(void *ctx, const char *data, size_t len){
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+// Render a response with chunked transfer, the writer buffer is the only copy of the output
+static esp_err_t mgmt_ap_respond(httpd_req_t *req, esp_err_t (*render)(stats_json_writer_t *writer, void *arg), void *arg){
+    // the writer lives on the heap, the httpd task stack is too small for it
+    stats_json_writer_t *writer = malloc(sizeof(stats_json_writer_t));
+    if (writer == NULL) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    stats_json_writer_init(writer, mgmt_ap_sink, req);
+    esp_err_t err = render(writer, arg);
+    if (err == ESP_OK) {
+        err = stats_json_flush(writer);
+    }
+    free(writer);
+
+    if (err != ESP_OK) {
+        // the status line is already sent, closing the connection truncates the response
+        ESP_LOGE(MGMT_AP_TAG, "Response aborted: %s", esp_err_to_name(err));
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Render the devices matching the parsed query
+static esp_err_t render_devices(stats_json_writer_t *writer, void *arg){
+    const devices_request_t *request = (const devices_request_t *)arg;
+    return stats_json_devices(writer, &request->query, request->limit);
+}
+
+// Render the APs
+static esp_err_t render_aps(stats_json_writer_t *writer, void *arg){
+    return stats_json_aps(writer);
+}
+
+// Render the counters
+static esp_err_t render_counters(stats_json_writer_t *writer, void *arg){
+    return stats_json_counters(writer);
+}
+
+// GET /devices?channel=&min_rssi=&since_ms=&oui=&order=&limit=
+static esp_err_t devices_handler(httpd_req_t *req){
+    char *query = NULL;
+    size_t query_len = httpd_req_get_url_query_len(req);
+    if (query_len > 0) {
+        query = malloc(query_len + 1);
+        if (query == NULL || httpd_req_get_url_query_str(req, query, query_len + 1) != ESP_OK) {
+            free(query);
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid query");
+        }
+    }
+
+    // validate the query before the status line is sent
+    devices_request_t request;
+    esp_err_t err = stats_json_parse_device_query(query, &request.query, &request.limit);
+    free(query);
+    if (err != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid query");
+    }
+    return mgmt_ap_respond(req, render_devices, &request);
+}
+
+// GET /aps
+static esp_err_t aps_handler(httpd_req_t *req){
+    return mgmt_ap_respond(req, render_aps, NULL);
+}
+
+// GET /counters
+static esp_err_t counters_handler(httpd_req_t *req){
+    return mgmt_ap_respond(req, render_counters, NULL);
+}
+
+// Bring up a password protected management AP and serve /devices, /aps and /counters as JSON
+esp_err_t start_mgmt_ap(const char *ssid, const char *password, uint8_t channel){
+    // Check input parameters, the management AP is never open
+    if (ssid == NULL || password == NULL || strlen(password) < MGMT_AP_MIN_PASSWORD || channel == 0 || channel > 14) {
+        ESP_LOGE(MGMT_AP_TAG, "Invalid input parameters");
+        return ESP_FAIL;
+    }
+    if (server != NULL) {
+        ESP_LOGE(MGMT_AP_TAG, "Management AP already started");
+        return ESP_FAIL;
+    }
+
+    // the AP shares the radio, a capture schedule hopping channels would take the AP along
+    esp_err_t err = radio_pin_channel(channel);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = create_wifi_softap(ssid, password, NULL, channel);
+    if (err != ESP_OK) {
+        radio_pin_channel(0);
+        return err;
+    }
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = MGMT_AP_PORT;
+    config.max_open_sockets = 2;
+    err = httpd_start(&server, &config);
+    if (err != ESP_OK) {
+        ESP_LOGE(MGMT_AP_TAG, "Failed to start HTTP server: %s", esp_err_to_name(err));
+        server = NULL;
+        stop_wifi_softap();
+        radio_pin_channel(0);
+        return err;
+    }
+
+    const httpd_uri_t uris[] = {
+        { .uri = "/devices", .method = HTTP_GET, .handler = devices_handler },
+        { .uri = "/aps", .method = HTTP_GET, .handler = aps_handler },
+        { .uri = "/counters", .method = HTTP_GET, .handler = counters_handler },
+    };
+    for (size_t i = 0; i < sizeof(uris) / sizeof(uris[0]); i++) {
+        httpd_register_uri_handler(server, &uris[i]);
+    }
+
+    ESP_LOGI(MGMT_AP_TAG, "Management AP %s serving on channel %u", ssid, channel);
+    return ESP_OK;
+}
+
+// Stop the HTTP server and take the management AP down
+esp_err_t stop_mgmt_ap(void){
+    if (server == NULL) {
+        return ESP_OK;
+    }
+    esp_err_t err = httpd_stop(server);
+    if (err != ESP_OK) {
+        ESP_LOGE(MGMT_AP_TAG, "Failed to stop HTTP server: %s", esp_err_to_name(err));
+        return err;
+    }
+    server = NULL;
+
+    // the AP goes before the pin, a hopping radio would drag a running AP along
+    err = stop_wifi_softap();
+    if (err != ESP_OK) {
+        ESP_LOGE(MGMT_AP_TAG, "Failed to stop management AP");
+        return err;
+    }
+    radio_pin_channel(0);
+    ESP_LOGI(MGMT_AP_TAG, "Management AP stopped");
+    return ESP_OK;
+}
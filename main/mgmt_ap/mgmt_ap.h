@@ -0,0 +1,17 @@
+#ifndef MGMT_AP_H
+#define MGMT_AP_H
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#define MGMT_AP_TAG "MGMT_AP"
+#define MGMT_AP_MIN_PASSWORD 8          // WPA2 passphrases are 8 to 63 characters
+#define MGMT_AP_PORT 80
+
+// Bring up a password protected management AP and serve /devices, /aps and /counters as JSON
+esp_err_t start_mgmt_ap(const char *ssid, const char *password, uint8_t channel);
+
+// Stop the HTTP server and take the management AP down, the radio is unpinned once the AP is gone
+esp_err_t stop_mgmt_ap(void);
+
+#endif // MGMT_AP_H
@@ -0,0 +1,291 @@
+#include "stats_json.h"
+#include "../deauth/deauth.h"
+#include "../channel_stats/channel_stats.h"
+#include "../seq_tracker/seq_tracker.h"
+#include "../capture_log/capture_log.h"
+#include "../device_events/device_events.h"
+#include "../radio/radio.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Start writing to a sink
+void stats_json_writer_init(stats_json_writer_t *writer, stats_json_sink_t sink, void *ctx){
+    writer->sink = sink;
+    writer->ctx = ctx;
+    writer->err = ESP_OK;
+    writer->len = 0;
+}
+
+// Pass the remaining output to the sink
+esp_err_t stats_json_flush(stats_json_writer_t *writer){
+    if (writer->err == ESP_OK && writer->len > 0) {
+        writer->err = writer->sink(writer->ctx, writer->buf, writer->len);
+    }
+    writer->len = 0;
+    return writer->err;
+}
+
+// Append formatted output, passing the buffer to the sink when it is full
+esp_err_t stats_json_printf(stats_json_writer_t *writer, const char *format, ...){
+    if (writer->err != ESP_OK) {
+        return writer->err;
+    }
+
+    // try the free space first, flush and retry once if the output did not fit
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = STATS_JSON_CHUNK_SIZE - writer->len;
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(writer->buf + writer->len, space, format, args);
+        va_end(args);
+        if (len < 0) {
+            writer->err = ESP_FAIL;
+            return writer->err;
+        }
+        if ((size_t)len < space) {
+            writer->len += len;
+            return ESP_OK;
+        }
+        if (attempt == 0 && stats_json_flush(writer) != ESP_OK) {
+            return writer->err;
+        }
+    }
+
+    ESP_LOGE(STATS_JSON_TAG, "Output larger than a chunk");
+    writer->err = ESP_ERR_INVALID_SIZE;
+    return writer->err;
+}
+
+// Find the value of a key in a URL query, returns its length or -1
+static int query_value(const char *query, const char *key, const char **value){
+    size_t key_len = strlen(key);
+    const char *pos = query;
+    while (pos != NULL && *pos != '\0') {
+        if (strncmp(pos, key, key_len) == 0 && pos[key_len] == '=') {
+            *value = pos + key_len + 1;
+            const char *end = strchr(*value, '&');
+            return end != NULL ? (int)(end - *value) : (int)strlen(*value);
+        }
+        pos = strchr(pos, '&');
+        if (pos != NULL) {
+            pos++;
+        }
+    }
+    return -1;
+}
+
+// Check that no key appears twice in a URL query, query_value() would only see the first one
+static bool query_keys_unique(const char *query){
+    for (const char *pos = query; pos != NULL; pos = strchr(pos, '&')) {
+        if (*pos == '&') {
+            pos++;
+        }
+        size_t key_len = strcspn(pos, "=&");
+        if (key_len == 0 || pos[key_len] != '=') {
+            continue;
+        }
+        for (const char *next = strchr(pos, '&'); next != NULL; next = strchr(next + 1, '&')) {
+            if (strncmp(next + 1, pos, key_len) == 0 && next[1 + key_len] == '=') {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Parse a decimal query value that must fill its whole length and lie within min..max
+static esp_err_t query_number(const char *value, int len, long long min, long long max, long long *number){
+    char *end;
+    if (len <= 0 || !(isdigit((unsigned char)value[0]) || (value[0] == '-' && len > 1))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    errno = 0;
+    *number = strtoll(value, &end, 10);
+    if (errno != 0 || end != value + len || *number < min || *number > max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+// Parse a URL query into a device query
+esp_err_t stats_json_parse_device_query(const char *query, device_query_t *device_query, uint32_t *limit){
+    if (device_query == NULL || limit == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(device_query, 0, sizeof(device_query_t));
+    *limit = 0;
+    if (query == NULL) {
+        return ESP_OK;
+    }
+
+    if (!query_keys_unique(query)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const char *value;
+    long long number;
+    int len;
+    if ((len = query_value(query, "channel", &value)) >= 0) {
+        if (query_number(value, len, 0, CHANNEL_STATS_CHANNELS, &number) != ESP_OK) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        device_query->channel = (uint8_t)number;
+    }
+    if ((len = query_value(query, "min_rssi", &value)) >= 0) {
+        if (query_number(value, len, INT8_MIN, 0, &number) != ESP_OK) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        device_query->min_rssi = (int8_t)number;
+    }
+    if ((len = query_value(query, "since_ms", &value)) >= 0) {
+        if (query_number(value, len, 0, INT64_MAX / 1000, &number) != ESP_OK) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        // devices seen within the last since_ms milliseconds
+        int64_t since = esp_timer_get_time() - number * 1000;
+        device_query->seen_after = since > 0 ? since : 1;
+    }
+    if ((len = query_value(query, "oui", &value)) >= 0) {
+        if (len != 6) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int i = 0; i < 6; i++) {
+            if (!isxdigit((unsigned char)value[i])) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        uint32_t oui = (uint32_t)strtoul(value, NULL, 16);
+        device_query->match_oui = true;
+        device_query->oui[0] = (uint8_t)(oui >> 16);
+        device_query->oui[1] = (uint8_t)(oui >> 8);
+        device_query->oui[2] = (uint8_t)oui;
+    }
+    if ((len = query_value(query, "order", &value)) >= 0) {
+        if (len == 9 && strncmp(value, "last_seen", 9) == 0) {
+            device_query->order = DEVICE_ORDER_LAST_SEEN;
+        } else if (len == 8 && strncmp(value, "activity", 8) == 0) {
+            device_query->order = DEVICE_ORDER_ACTIVITY;
+        } else {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if ((len = query_value(query, "limit", &value)) >= 0) {
+        if (query_number(value, len, 0, UINT32_MAX, &number) != ESP_OK) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        *limit = (uint32_t)number;
+    }
+    return ESP_OK;
+}
+
+// Render the devices matching a query
+esp_err_t stats_json_devices(stats_json_writer_t *writer, const device_query_t *query, uint32_t limit){
+    device_cursor_t cursor;
+    device_entry_t entries[STATS_JSON_PAGE];
+    uint32_t count = 0;
+    size_t page;
+
+    esp_err_t err = query_devices(&cursor, query);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // the cursor reads the live table a page at a time while the capture goes on, each device
+    // present when the dump started is rendered once, from a consistent copy of its node
+    stats_json_printf(writer, "{\"devices\":[");
+    while ((limit == 0 || count < limit) &&
+           (page = device_cursor_next_page(&cursor, entries, STATS_JSON_PAGE)) > 0) {
+        for (size_t i = 0; i < page && (limit == 0 || count < limit); i++) {
+            device_node_t snapshot;
+            const device_node_t *node = &snapshot;
+            device_node_snapshot(entries[i].node, &snapshot);
+            const uint8_t *mac = node->mac_addr;
+            seq_link_t link;
+            if (seq_tracker_get_link(mac, &link) != ESP_OK) {
+                memset(&link, 0, sizeof(link));
+            }
+            stats_json_printf(writer,
+                "%s{\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"channel\":%u,\"rssi\":%d,\"frames\":%lu,"
+                "\"first_seen_ms\":%lld,\"last_seen_ms\":%lld,\"retries\":%lu,\"lost\":%lu}",
+                count == 0 ? "" : ",", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+                entries[i].channel, node->rssi, (unsigned long)node->frame_count,
+                (long long)(node->first_seen / 1000), (long long)(node->last_seen / 1000),
+                (unsigned long)link.retries, (unsigned long)link.lost);
+            count++;
+        }
+        if (writer->err != ESP_OK) {
+            break;
+        }
+    }
+    device_cursor_deinit(&cursor);
+    return stats_json_printf(writer, "],\"count\":%lu}", (unsigned long)count);
+}
+
+// Render a string with JSON escaping
+static void stats_json_string(stats_json_writer_t *writer, const char *str, size_t max_len){
+    stats_json_printf(writer, "\"");
+    for (size_t i = 0; i < max_len && str[i] != '\0'; i++) {
+        unsigned char c = (unsigned char)str[i];
+        if (c == '"' || c == '\\') {
+            stats_json_printf(writer, "\\%c", c);
+        } else if (c < 0x20) {
+            stats_json_printf(writer, "\\u%04x", c);
+        } else {
+            stats_json_printf(writer, "%c", c);
+        }
+    }
+    stats_json_printf(writer, "\"");
+}
+
+// Render the APs found by scans
+esp_err_t stats_json_aps(stats_json_writer_t *writer){
+    wifi_ap_record_t records[STATS_JSON_AP_PAGE];
+    uint16_t count = 0;
+    uint16_t page;
+
+    stats_json_printf(writer, "{\"aps\":[");
+    // copy a few records at a time so a concurrent scan cannot free them under us
+    while ((page = get_AP_records(records, count, STATS_JSON_AP_PAGE)) > 0 && writer->err == ESP_OK) {
+        for (uint16_t i = 0; i < page; i++) {
+            const uint8_t *bssid = records[i].bssid;
+            stats_json_printf(writer, "%s{\"ssid\":", count + i == 0 ? "" : ",");
+            stats_json_string(writer, (const char *)records[i].ssid, sizeof(records[i].ssid));
+            stats_json_printf(writer, ",\"bssid\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"channel\":%u,\"rssi\":%d}",
+                              bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5],
+                              records[i].primary, records[i].rssi);
+        }
+        count += page;
+    }
+    return stats_json_printf(writer, "],\"count\":%u}", count);
+}
+
+// Render the per-channel activity of the current minute and the capture counters
+esp_err_t stats_json_counters(stats_json_writer_t *writer){
+    radio_stats_t radio_stats;
+    int64_t now = esp_timer_get_time();
+
+    stats_json_printf(writer, "{\"channels\":[");
+    for (uint8_t channel = 1; channel <= CHANNEL_STATS_CHANNELS; channel++) {
+        channel_stats_bucket_t minute;
+        const channel_stats_bucket_t *bucket = &minute;
+        channel_stats_read(channel, CHANNEL_STATS_MINUTE, 1, now, &minute);
+        stats_json_printf(writer, "%s{\"channel\":%u,\"devices\":%lu,\"frames\":%lu,\"new_devices\":%u,"
+                          "\"mean_rssi\":%d,\"airtime_us\":%lu}",
+                          channel == 1 ? "" : ",", channel, (unsigned long)get_device_count(channel),
+                          (unsigned long)bucket->frames, bucket->new_devices,
+                          channel_stats_mean_rssi(bucket), (unsigned long)bucket->airtime_us);
+    }
+
+    radio_get_stats(&radio_stats);
+    return stats_json_printf(writer, "],\"radio\":{\"capture_ms\":%lld,\"blind_ms\":%lld,\"channel_switches\":%lu,"
+                             "\"scans\":%lu,\"driver_restarts\":%lu},\"log_dropped\":%lu,\"events_dropped\":%lu}",
+                             (long long)(radio_stats.capture_us / 1000), (long long)(radio_stats.blind_us / 1000),
+                             (unsigned long)radio_stats.channel_switches, (unsigned long)radio_stats.scans,
+                             (unsigned long)radio_stats.driver_restarts, (unsigned long)capture_log_dropped(),
+                             (unsigned long)device_events_dropped());
+}
@@ -0,0 +1,50 @@
+#ifndef STATS_JSON_H
+#define STATS_JSON_H
+
+// Incremental JSON rendering of the live tables, independent of the HTTP server so it also runs on the host
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <esp_err.h>
+#include "../device_list/device_list.h"
+
+#define STATS_JSON_TAG "STATS_JSON"
+#define STATS_JSON_CHUNK_SIZE 1024      // output is passed to the sink in chunks of at most this size
+#define STATS_JSON_PAGE 16              // devices read from the cursor at a time
+#define STATS_JSON_AP_PAGE 4            // AP records copied at a time
+
+// Receives the rendered output chunk by chunk, e.g. httpd_resp_send_chunk()
+typedef esp_err_t (*stats_json_sink_t)(void *ctx, const char *data, size_t len);
+
+// Fixed-size output buffer in front of a sink
+typedef struct {
+    stats_json_sink_t sink;
+    void *ctx;
+    esp_err_t err;                      // first sink error, later writes are dropped
+    size_t len;
+    char buf[STATS_JSON_CHUNK_SIZE];
+} stats_json_writer_t;
+
+// Start writing to a sink
+void stats_json_writer_init(stats_json_writer_t *writer, stats_json_sink_t sink, void *ctx);
+
+// Append formatted output, passing the buffer to the sink when it is full
+esp_err_t stats_json_printf(stats_json_writer_t *writer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Pass the remaining output to the sink
+esp_err_t stats_json_flush(stats_json_writer_t *writer);
+
+// Parse a URL query such as "channel=6&min_rssi=-70&since_ms=60000&oui=aabbcc&order=activity&limit=100", ESP_ERR_INVALID_ARG if a value is malformed or out of range or a key is repeated
+esp_err_t stats_json_parse_device_query(const char *query, device_query_t *device_query, uint32_t *limit);
+
+// Render the devices matching a query, at most limit devices (0 = no limit)
+esp_err_t stats_json_devices(stats_json_writer_t *writer, const device_query_t *query, uint32_t limit);
+
+// Render the APs found by scans
+esp_err_t stats_json_aps(stats_json_writer_t *writer);
+
+// Render the per-channel activity of the current minute and the capture counters
+esp_err_t stats_json_counters(stats_json_writer_t *writer);
+
+#endif // STATS_JSON_H
@@ -0,0 +1,317 @@
+#include "radio.h"
+#include <esp_wifi.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define RADIO_MAX_SCAN_RECORDS 16
+
+static bool initialized = false;
+static volatile bool running = false;
+static radio_schedule_t schedule;
+static radio_scan_cb_t scan_cb = NULL;
+static radio_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t stopped_semaphore = NULL;
+static SemaphoreHandle_t driver_mutex = NULL;  // held by the radio task around switches and scans, and by radio_pause()
+static int64_t paused_since = 0;               // 0 while not paused, under stats_lock
+static int64_t paused_us = 0;                  // total time paused, under stats_lock
+static volatile uint8_t current_channel = 0;   // read by the RX callback
+static volatile uint8_t pinned_channel = 0;    // only channel visited while set, e.g. by a SoftAP
+static uint32_t visits[RADIO_CHANNELS];
+static wifi_ap_record_t scan_records[RADIO_MAX_SCAN_RECORDS];
+
+// Add listening and blind time to the stats
+static void radio_account(int64_t capture_us, int64_t blind_us, uint32_t switches, uint32_t scans, uint32_t restarts){
+    portENTER_CRITICAL(&stats_lock);
+    stats.capture_us += capture_us;
+    stats.blind_us += blind_us;
+    stats.channel_switches += switches;
+    stats.scans += scans;
+    stats.driver_restarts += restarts;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// Time the driver was paused up to now, including a pause in progress
+static int64_t radio_paused_time(int64_t now){
+    portENTER_CRITICAL(&stats_lock);
+    int64_t total = paused_us + (paused_since != 0 ? now - paused_since : 0);
+    portEXIT_CRITICAL(&stats_lock);
+    return total;
+}
+
+// Tune to a channel unless the radio is already there
+static void radio_set_channel(uint8_t channel){
+    if (channel == current_channel) {
+        return;
+    }
+    if (esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) != ESP_OK) {
+        ESP_LOGE(RADIO_TAG, "Failed to set channel %d", channel);
+        return;
+    }
+    current_channel = channel;
+    radio_account(0, 0, 1, 0, 0);
+}
+
+// Short active scan of a single channel, promiscuous mode stays enabled
+static void radio_scan_slice(uint8_t channel){
+    wifi_scan_config_t scan_config = {
+        .channel = channel,
+        .show_hidden = true,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active = {
+            .min = schedule.scan_ms,
+            .max = schedule.scan_ms
+        }
+    };
+    if (esp_wifi_scan_start(&scan_config, true) != ESP_OK) {
+        ESP_LOGE(RADIO_TAG, "Failed to scan channel %d", channel);
+        return;
+    }
+
+    // fetching the records also frees the driver's scan list
+    uint16_t count = RADIO_MAX_SCAN_RECORDS;
+    if (esp_wifi_scan_get_ap_records(&count, scan_records) == ESP_OK && count > 0 && scan_cb != NULL) {
+        scan_cb(scan_records, count);
+    }
+    radio_account(0, 0, 0, 1, 0);
+
+    // the scan may leave the radio on another channel
+    current_channel = 0;
+    radio_set_channel(channel);
+}
+
+// Radio task, visits the scheduled channels and measures the time it is not listening
+static void radio_task(void *arg){
+    while (running) {
+        for (uint8_t channel = 1; channel <= RADIO_CHANNELS && running; channel++) {
+            // a pin overrides the schedule's channels from the next visit on
+            uint8_t pin = pinned_channel;
+            uint16_t channel_mask = pin != 0 ? 1 << (pin - 1) : schedule.channel_mask;
+            if ((channel_mask & (1 << (channel - 1))) == 0) {
+                continue;
+            }
+
+            // waits here while the driver is paused, that time is accounted by radio_resume()
+            xSemaphoreTake(driver_mutex, portMAX_DELAY);
+            int64_t start = esp_timer_get_time();
+            radio_set_channel(channel);
+            if (schedule.scan_ms != 0 && schedule.scan_every != 0 && visits[channel - 1] % schedule.scan_every == 0) {
+                radio_scan_slice(channel);
+            }
+            visits[channel - 1]++;
+            xSemaphoreGive(driver_mutex);
+
+            // a pause during the dwell is blind time, not capture time
+            int64_t listen = esp_timer_get_time();
+            int64_t paused = radio_paused_time(listen);
+            vTaskDelay(pdMS_TO_TICKS(schedule.dwell_ms));
+            int64_t end = esp_timer_get_time();
+            radio_account(end - listen - (radio_paused_time(end) - paused), listen - start, 0, 0, 0);
+        }
+    }
+
+    xSemaphoreGive(stopped_semaphore);
+    vTaskDelete(NULL);
+}
+
+// Take ownership of the Wi-Fi driver and keep promiscuous mode up
+esp_err_t radio_init(wifi_promiscuous_cb_t rx_callback, radio_scan_cb_t scan_callback){
+    // Check input parameters
+    if (rx_callback == NULL) {
+        ESP_LOGE(RADIO_TAG, "Invalid input parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    wifi_mode_t mode;
+    esp_err_t err = esp_wifi_get_mode(&mode);
+    if (err != ESP_OK) {
+        ESP_LOGE(RADIO_TAG, "Failed to get wifi mode");
+        return err;
+    }
+
+    if (driver_mutex == NULL) {
+        driver_mutex = xSemaphoreCreateMutex();
+        if (driver_mutex == NULL) {
+            ESP_LOGE(RADIO_TAG, "Failed to create mutex");
+            return ESP_FAIL;
+        }
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    memset(visits, 0, sizeof(visits));
+    paused_us = 0;
+
+    // scanning needs the STA interface, a running SoftAP is kept; this is the only mode change
+    if (mode != WIFI_MODE_STA && mode != WIFI_MODE_APSTA) {
+        int64_t start = esp_timer_get_time();
+        err = esp_wifi_set_mode(mode == WIFI_MODE_AP ? WIFI_MODE_APSTA : WIFI_MODE_STA);
+        if (err != ESP_OK) {
+            ESP_LOGE(RADIO_TAG, "Failed to set wifi mode");
+            return err;
+        }
+        radio_account(0, esp_timer_get_time() - start, 0, 0, 1);
+    }
+
+    // Enable promiscuous mode for good
+    wifi_promiscuous_filter_t filter = {
+        .filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA
+    };
+    esp_wifi_set_promiscuous_filter(&filter);
+    esp_wifi_set_promiscuous_rx_cb(rx_callback);
+    err = esp_wifi_set_promiscuous(true);
+    if (err != ESP_OK) {
+        ESP_LOGE(RADIO_TAG, "Failed to enable promiscuous mode");
+        return err;
+    }
+
+    scan_cb = scan_callback;
+    current_channel = 0;
+    initialized = true;
+    ESP_LOGI(RADIO_TAG, "Radio initialized");
+    return ESP_OK;
+}
+
+// Start hopping channels and scanning following the schedule
+esp_err_t radio_start(const radio_schedule_t *radio_schedule){
+    // Check input parameters
+    if (radio_schedule == NULL || (radio_schedule->channel_mask & RADIO_ALL_CHANNELS) == 0 || radio_schedule->dwell_ms == 0) {
+        ESP_LOGE(RADIO_TAG, "Invalid input parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!initialized || running) {
+        ESP_LOGE(RADIO_TAG, "Radio not initialized or already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (stopped_semaphore == NULL) {
+        stopped_semaphore = xSemaphoreCreateBinary();
+        if (stopped_semaphore == NULL) {
+            ESP_LOGE(RADIO_TAG, "Failed to create semaphore");
+            return ESP_FAIL;
+        }
+    }
+
+    schedule = *radio_schedule;
+    if (pinned_channel != 0) {
+        ESP_LOGI(RADIO_TAG, "Radio pinned to channel %u, schedule channels ignored", pinned_channel);
+    }
+    running = true;
+    if (xTaskCreate(radio_task, "radio", 3072, NULL, tskIDLE_PRIORITY + 2, NULL) != pdPASS) {
+        ESP_LOGE(RADIO_TAG, "Failed to create task");
+        running = false;
+        return ESP_FAIL;
+    }
+    ESP_LOGI(RADIO_TAG, "Radio started");
+    return ESP_OK;
+}
+
+// Stop the radio task
+esp_err_t radio_stop(void){
+    if (!running) {
+        return ESP_OK;
+    }
+
+    // the task finishes its current channel visit
+    running = false;
+    xSemaphoreTake(stopped_semaphore, portMAX_DELAY);
+
+    radio_stats_t current;
+    radio_get_stats(&current);
+    ESP_LOGI(RADIO_TAG, "Radio stopped, listening %lld ms, blind %lld ms", (long long)(current.capture_us / 1000), (long long)(current.blind_us / 1000));
+    return ESP_OK;
+}
+
+// Get the coverage of the radio
+esp_err_t radio_get_stats(radio_stats_t *radio_stats){
+    if (radio_stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&stats_lock);
+    *radio_stats = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
+
+// Keep the radio task off the driver, e.g. while a SoftAP changes the mode or MAC address
+esp_err_t radio_pause(void){
+    if (!initialized) {
+        return ESP_OK;
+    }
+
+    // the task finishes its current channel switch or scan first
+    if (xSemaphoreTake(driver_mutex, portMAX_DELAY) != pdTRUE) {
+        ESP_LOGE(RADIO_TAG, "Failed to take driver mutex");
+        return ESP_FAIL;
+    }
+    portENTER_CRITICAL(&stats_lock);
+    paused_since = esp_timer_get_time();
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
+
+// Hand the driver back to the radio task, the paused time is accounted as blind time
+esp_err_t radio_resume(bool driver_restarted){
+    if (!initialized) {
+        return ESP_OK;
+    }
+
+    // a restarted driver comes back without promiscuous mode, the channel is unknown either way
+    esp_err_t err = ESP_OK;
+    if (driver_restarted) {
+        err = esp_wifi_set_promiscuous(true);
+        if (err != ESP_OK) {
+            ESP_LOGE(RADIO_TAG, "Failed to enable promiscuous mode");
+        }
+    }
+    current_channel = 0;
+
+    portENTER_CRITICAL(&stats_lock);
+    int64_t blind_us = esp_timer_get_time() - paused_since;
+    paused_us += blind_us;
+    paused_since = 0;
+    stats.blind_us += blind_us;
+    stats.driver_restarts += driver_restarted ? 1 : 0;
+    portEXIT_CRITICAL(&stats_lock);
+
+    xSemaphoreGive(driver_mutex);
+    return err;
+}
+
+// Stop the radio and hand the driver back, promiscuous mode is disabled
+esp_err_t radio_deinit(void){
+    if (!initialized) {
+        return ESP_OK;
+    }
+    radio_stop();
+    esp_wifi_set_promiscuous(false);
+    scan_cb = NULL;
+    current_channel = 0;
+    initialized = false;
+    ESP_LOGI(RADIO_TAG, "Radio released the driver");
+    return ESP_OK;
+}
+
+// Keep the radio on one channel whatever the schedule, 0 to follow the schedule again
+esp_err_t radio_pin_channel(uint8_t channel){
+    // Check input parameters
+    if (channel > RADIO_CHANNELS) {
+        ESP_LOGE(RADIO_TAG, "Invalid input parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    pinned_channel = channel;
+    return ESP_OK;
+}
+
+// Check if the radio owns the driver
+bool radio_is_initialized(void){
+    return initialized;
+}
+
+// Channel the radio is tuned to, 0 while unknown
+uint8_t radio_get_channel(void){
+    return current_channel;
+}
@@ -0,0 +1,72 @@
+#ifndef RADIO_H
+#define RADIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_wifi_types.h>
+
+#define RADIO_TAG "RADIO"
+#define RADIO_CHANNELS 14
+#define RADIO_ALL_CHANNELS 0x1fff       // channels 1 to 13
+
+// Schedule of the radio task, capture and scan slices are interleaved per channel
+typedef struct {
+    uint16_t channel_mask;              // bit n set = channel n + 1 is visited
+    uint16_t dwell_ms;                  // capture time per channel visit
+    uint16_t scan_ms;                   // active scan slice on the visited channel, 0 = never scan
+    uint8_t scan_every;                 // scan a channel on every n-th visit
+} radio_schedule_t;
+
+#define RADIO_DEFAULT_SCHEDULE() {      \
+    .channel_mask = RADIO_ALL_CHANNELS, \
+    .dwell_ms = 500,                    \
+    .scan_ms = 60,                      \
+    .scan_every = 10                    \
+}
+
+// Coverage of the radio since radio_init()
+typedef struct {
+    int64_t capture_us;                 // time spent listening on a channel
+    int64_t blind_us;                   // time lost to channel switches, scans and driver restarts
+    uint32_t channel_switches;
+    uint32_t scans;
+    uint32_t driver_restarts;
+} radio_stats_t;
+
+// Called with the access points found by a scan slice, from the radio task
+typedef void (*radio_scan_cb_t)(const wifi_ap_record_t *records, uint16_t count);
+
+// Take ownership of the Wi-Fi driver and keep promiscuous mode up with the given callbacks
+esp_err_t radio_init(wifi_promiscuous_cb_t rx_callback, radio_scan_cb_t scan_callback);
+
+// Start hopping channels and scanning following the schedule
+esp_err_t radio_start(const radio_schedule_t *schedule);
+
+// Stop the radio task, promiscuous mode stays up on the current channel
+esp_err_t radio_stop(void);
+
+// Get the coverage of the radio
+esp_err_t radio_get_stats(radio_stats_t *stats);
+
+// Keep the radio task off the driver, e.g. while a SoftAP changes the mode or MAC address, nothing to do
+// while the radio does not own the driver; every pause must be followed by radio_resume() from the same task
+esp_err_t radio_pause(void);
+
+// Hand the driver back to the radio task, with promiscuous mode re-enabled after a driver restart; the
+// paused time is accounted as blind time
+esp_err_t radio_resume(bool driver_restarted);
+
+// Stop the radio and hand the driver back, promiscuous mode is disabled
+esp_err_t radio_deinit(void);
+
+// Keep the radio on one channel whatever the schedule, e.g. the channel of a SoftAP, 0 to follow the schedule again
+esp_err_t radio_pin_channel(uint8_t channel);
+
+// Check if the radio owns the driver, other modules must then keep the STA interface and promiscuous mode
+bool radio_is_initialized(void);
+
+// Channel the radio is tuned to, 0 while unknown
+uint8_t radio_get_channel(void);
+
+#endif // RADIO_H
@@ -0,0 +1,124 @@
+#include "seq_tracker.h"
+#include <string.h>
+
+#define FRAME_TYPE_DATA 2
+#define FRAME_TYPE_CONTROL 1
+#define FRAME_SUBTYPE_QOS 0x80         // data subtypes with bit 3 set carry a QoS Control field
+#define FRAME_SUBTYPE_QOS_NULL 0xc0
+#define FRAME_FLAG_RETRY 0x08
+#define FRAME_FLAGS_DS 0x03
+#define SEQ_HEADER_LEN 24
+
+_Static_assert((SEQ_TRACKER_SIZE & (SEQ_TRACKER_SIZE - 1)) == 0, "SEQ_TRACKER_SIZE must be a power of two");
+
+// Direct-mapped table, a transmitter evicts the one it collides with
+static seq_link_t links[SEQ_TRACKER_SIZE];
+
+// Slot of a transmitter, the last bytes of a MAC address are the most random
+static inline uint32_t seq_tracker_slot(const uint8_t *mac_addr){
+    return (mac_addr[5] ^ (mac_addr[4] << 3) ^ (mac_addr[3] << 6)) & (SEQ_TRACKER_SIZE - 1);
+}
+
+// Find the QoS sequence of a receiver and TID, replacing the oldest one if it is not followed yet
+static seq_stream_t *seq_tracker_stream(seq_link_t *link, const uint8_t *receiver, uint8_t tid){
+    for (int i = 0; i < SEQ_TRACKER_QOS_STREAMS; i++) {
+        seq_stream_t *stream = &link->qos[i];
+        if (stream->valid && stream->tid == tid && memcmp(stream->receiver, receiver, 6) == 0) {
+            return stream;
+        }
+    }
+
+    // a new stream starts unsynchronized, so replacing one never counts loss
+    seq_stream_t *stream = &link->qos[link->next_stream];
+    link->next_stream = (link->next_stream + 1) % SEQ_TRACKER_QOS_STREAMS;
+    memcpy(stream->receiver, receiver, 6);
+    stream->tid = tid;
+    stream->valid = 0;
+    return stream;
+}
+
+// Check a received frame against its transmitter's last sequence number
+bool seq_tracker_check(const uint8_t *frame, uint16_t length){
+    // Control frames have no Sequence Control field
+    if (length < SEQ_HEADER_LEN) {
+        return false;
+    }
+    uint8_t type = (frame[0] >> 2) & 0x03;
+    if (type == FRAME_TYPE_CONTROL) {
+        return false;
+    }
+
+    const uint8_t *receiver = frame + 4;  // Receiver address is at offset 4
+    const uint8_t *mac_addr = frame + 10; // Transmitter address is at offset 10
+    bool retry = (frame[1] & FRAME_FLAG_RETRY) != 0;
+    uint16_t seq_ctrl = frame[22] | (frame[23] << 8);
+    bool qos = false;
+    uint8_t tid = 0;
+    if (type == FRAME_TYPE_DATA && (frame[0] & FRAME_SUBTYPE_QOS)) {
+        // QoS Null frames are not numbered reliably, the QoS Control field follows the fourth address if present
+        uint16_t qos_offset = (frame[1] & FRAME_FLAGS_DS) == FRAME_FLAGS_DS ? 30 : 24;
+        if ((frame[0] & 0xf0) == FRAME_SUBTYPE_QOS_NULL || length < qos_offset + 2) {
+            return false;
+        }
+        // individually addressed QoS data is numbered per receiver and TID, group addressed
+        // QoS data shares the counter of management and non-QoS data
+        qos = (receiver[0] & 0x01) == 0;
+        tid = frame[qos_offset] & 0x0f;
+    }
+
+    seq_link_t *link = &links[seq_tracker_slot(mac_addr)];
+    if (memcmp(link->mac_addr, mac_addr, 6) != 0) {
+        memset(link, 0, sizeof(seq_link_t));
+        memcpy(link->mac_addr, mac_addr, 6);
+    }
+
+    uint8_t *valid = &link->valid;
+    uint16_t *last = &link->seq_ctrl;
+    if (qos) {
+        seq_stream_t *stream = seq_tracker_stream(link, receiver, tid);
+        valid = &stream->valid;
+        last = &stream->seq_ctrl;
+    }
+
+    if (*valid) {
+        // a retransmission of the last frame was already counted
+        if (retry && seq_ctrl == *last) {
+            link->retries++;
+            link->duplicates++;
+            return true;
+        }
+
+        // frames skipped in the sequence were lost, unless the jump is too large to be loss
+        uint16_t gap = ((seq_ctrl >> 4) - (*last >> 4)) & 0x0fff;
+        if (gap > 1 && gap <= SEQ_TRACKER_MAX_GAP) {
+            link->lost += gap - 1;
+        }
+    }
+
+    *valid = 1;
+    *last = seq_ctrl;
+    link->frames++;
+    if (retry) {
+        link->retries++;
+    }
+    return false;
+}
+
+// Get the link statistics of a transmitter
+esp_err_t seq_tracker_get_link(const uint8_t *mac_addr, seq_link_t *link){
+    if (mac_addr == NULL || link == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const seq_link_t *entry = &links[seq_tracker_slot(mac_addr)];
+    if (entry->frames == 0 || memcmp(entry->mac_addr, mac_addr, 6) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *link = *entry;
+    return ESP_OK;
+}
+
+// Forget all transmitters
+void seq_tracker_clear(void){
+    memset(links, 0, sizeof(links));
+}
@@ -0,0 +1,43 @@
+#ifndef SEQ_TRACKER_H
+#define SEQ_TRACKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#define SEQ_TRACKER_TAG "SEQ_TRACKER"
+#define SEQ_TRACKER_SIZE 256        // number of transmitters tracked, must be a power of two
+#define SEQ_TRACKER_MAX_GAP 64      // larger sequence jumps resynchronize instead of counting as loss
+#define SEQ_TRACKER_QOS_STREAMS 4   // QoS (receiver, TID) sequences followed per transmitter
+
+// QoS data sequence of a transmitter towards one receiver and TID
+typedef struct {
+    uint8_t receiver[6];            // receiver MAC address
+    uint8_t tid;
+    uint8_t valid;
+    uint16_t seq_ctrl;              // last Sequence Control
+} seq_stream_t;
+
+// Link statistics of a transmitter, derived from the Sequence Control field
+typedef struct {
+    uint8_t mac_addr[6];            // transmitter MAC address
+    uint8_t valid;                  // management/non-QoS data sequence seen
+    uint8_t next_stream;            // QoS stream replaced when a new one shows up
+    uint16_t seq_ctrl;              // last Sequence Control of management, non-QoS and group addressed data frames
+    seq_stream_t qos[SEQ_TRACKER_QOS_STREAMS];
+    uint32_t frames;                // unique frames received
+    uint32_t retries;               // frames received with the retry bit set
+    uint32_t duplicates;            // retransmissions of a frame that was already received
+    uint32_t lost;                  // frames missing from sequence gaps
+} seq_link_t;
+
+// Check a received frame against its transmitter's last sequence number, returns true for duplicates
+bool seq_tracker_check(const uint8_t *frame, uint16_t length);
+
+// Get the link statistics of a transmitter, ESP_ERR_NOT_FOUND if it is not tracked
+esp_err_t seq_tracker_get_link(const uint8_t *mac_addr, seq_link_t *link);
+
+// Forget all transmitters
+void seq_tracker_clear(void);
+
+#endif // SEQ_TRACKER_H
@@ -1,4 +1,5 @@
 #include "softAP.h"
+#include "../radio/radio.h"
 #include <esp_wifi.h>
 #include <esp_log.h>
 #include <string.h>
@@ -53,29 +54,36 @@ static void prank_ap_switch(TimerHandle_t xTimer) {
     prank_info->current_index = (prank_info->current_index + 1) % MAX_SSID_COUNT;
 }
 
-// Create a WiFi SoftAP network interface instance
-esp_err_t create_wifi_softap(const char *ssid, const char *password, const uint8_t *mac_address, uint8_t channel) {
-    // Stop current wifi first
-    esp_wifi_stop();
-
-    // Destroy existing network interface
-    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
-    if (netif != NULL) {
-        esp_netif_destroy(netif);
+// Apply the SoftAP mode, MAC address and configuration, the radio task is kept off the driver meanwhile
+static esp_err_t configure_wifi_softap(const char *ssid, const char *password, const uint8_t *mac_address, uint8_t channel, bool *restarted) {
+    // Keep the STA interface when the radio manager owns the driver, so capture and scans go on
+    wifi_mode_t mode = radio_is_initialized() ? WIFI_MODE_APSTA : WIFI_MODE_AP;
+    wifi_mode_t current_mode;
+    esp_err_t err = esp_wifi_get_mode(&current_mode);
+    if (err != ESP_OK) {
+        return err;
     }
 
-    // Create network interface for SoftAP
-    esp_netif_config_t cfg = ESP_NETIF_DEFAULT_WIFI_AP();
-    esp_netif_t *wifi_ap = esp_netif_new(&cfg);
+    // The MAC address can only change while the driver is stopped, skip the restart when it is already set
+    uint8_t current_mac[6];
+    bool restart = mac_address != NULL &&
+                   (current_mode == WIFI_MODE_NULL || current_mode == WIFI_MODE_STA ||
+                    esp_wifi_get_mac(WIFI_IF_AP, current_mac) != ESP_OK || memcmp(current_mac, mac_address, 6) != 0);
+    if (restart) {
+        esp_wifi_stop();
+        *restarted = true;
+    }
 
-    // Attach Wi-Fi driver to network interface
-    esp_netif_attach_wifi_station(wifi_ap);
-    esp_wifi_set_default_wifi_sta_handlers();
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+    if (current_mode != mode) {
+        err = esp_wifi_set_mode(mode);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
 
     // Set MAC address if provided
-    if (mac_address != NULL) {
-        esp_err_t err = esp_wifi_set_mac(WIFI_IF_AP, mac_address);
+    if (restart) {
+        err = esp_wifi_set_mac(WIFI_IF_AP, mac_address);
         if (err != ESP_OK) {
             ESP_LOGE(SOFTAP_TAG, "Failed to set MAC address");
             return err;
@@ -98,22 +106,51 @@ esp_err_t create_wifi_softap(const char *ssid, const char *password, const uint8
     strlcpy((char *)wifi_config.ap.ssid, ssid, sizeof(wifi_config.ap.ssid));
     wifi_config.ap.channel = channel;
 
-    // Set the Wi-Fi mode to SoftAP
-    esp_err_t err = esp_wifi_set_mode(WIFI_MODE_AP);
+    // Set the SoftAP configuration, a running driver applies it without a restart
+    err = esp_wifi_set_config(WIFI_IF_AP, &wifi_config);
     if (err != ESP_OK) {
         return err;
     }
+    return esp_wifi_start();
+}
 
-    // Set the SoftAP configuration
-    err = esp_wifi_set_config(WIFI_IF_AP, &wifi_config);
+// Create a WiFi SoftAP network interface instance
+esp_err_t create_wifi_softap(const char *ssid, const char *password, const uint8_t *mac_address, uint8_t channel) {
+    // Create the network interface once, it is reused by every SoftAP
+    if (esp_netif_get_handle_from_ifkey("WIFI_AP_DEF") == NULL && esp_netif_create_default_wifi_ap() == NULL) {
+        ESP_LOGE(SOFTAP_TAG, "Failed to create network interface");
+        return ESP_FAIL;
+    }
+
+    // The radio manager owns the driver, it resumes with promiscuous mode back up after a restart
+    esp_err_t err = radio_pause();
     if (err != ESP_OK) {
         return err;
     }
-
-    // Start the Wi-Fi driver
-    return esp_wifi_start();
+    bool restarted = false;
+    err = configure_wifi_softap(ssid, password, mac_address, channel, &restarted);
+    esp_err_t resume_err = radio_resume(restarted);
+    return err != ESP_OK ? err : resume_err;
 }
 
+// Take the SoftAP down, back to STA mode while the radio manager owns the driver, otherwise the driver is stopped
+esp_err_t stop_wifi_softap(void) {
+    if (!radio_is_initialized()) {
+        return esp_wifi_stop();
+    }
+
+    esp_err_t err = radio_pause();
+    if (err != ESP_OK) {
+        return err;
+    }
+    wifi_mode_t mode;
+    err = esp_wifi_get_mode(&mode);
+    if (err == ESP_OK && (mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA)) {
+        err = esp_wifi_set_mode(WIFI_MODE_STA);
+    }
+    esp_err_t resume_err = radio_resume(false);
+    return err != ESP_OK ? err : resume_err;
+}
 
 // Start the prank with multiple APs
 esp_err_t start_prank_multiple_aps(const char **ssids, const char **passwords, const uint8_t mac_addresses[][6], uint8_t channel) {
@@ -171,8 +208,8 @@ esp_err_t stop_prank_multiple_aps() {
     free(prank_info);
     prank_info = NULL;
 
-    // Stop Wi-Fi driver
-    esp_wifi_stop();
+    // Take the SoftAP down
+    stop_wifi_softap();
 
     ESP_LOGI(SOFTAP_TAG, "Prank stopped");
 
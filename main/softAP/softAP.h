@@ -20,6 +20,9 @@ typedef struct {
 // Create a WiFi SoftAP network interface instance
 esp_err_t create_wifi_softap(const char *ssid, const char *password, const uint8_t *mac_address, uint8_t channel);
 
+// Take the SoftAP down, back to STA mode while the radio manager owns the driver, otherwise the driver is stopped
+esp_err_t stop_wifi_softap(void);
+
 // Start the prank with multiple APs
 esp_err_t start_prank_multiple_aps(const char **ssids, const char **passwords, const uint8_t mac_addresses[][6], uint8_t channel);
 
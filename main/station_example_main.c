@@ -9,7 +9,8 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "deauth/deauth.h"
-#include "softap/softap.h"
+#include "softAP/softAP.h"
+#include "mgmt_ap/mgmt_ap.h"
 
 void init(void){
     // Initialize NVS
@@ -52,6 +53,26 @@ void app_main(void)
     display_APs_info();
     */
 
+    // capture on all channels while scanning for APs, without blind mode changes
+    /*
+    radio_schedule_t schedule = RADIO_DEFAULT_SCHEDULE();
+    start_radio_capture(&schedule);
+    vTaskDelay(60000 / portTICK_PERIOD_MS);
+    stop_radio_capture();
+    display_devices_info(0);
+    display_APs_info();
+    */
+
+    // serve the tables at http://192.168.4.1/devices, the capture stays on the AP channel meanwhile
+    /*
+    radio_schedule_t mgmt_schedule = RADIO_DEFAULT_SCHEDULE();
+    start_radio_capture(&mgmt_schedule);
+    start_mgmt_ap("sniffy", "change-me-please", 6);
+    vTaskDelay(600000 / portTICK_PERIOD_MS);
+    stop_mgmt_ap();
+    stop_radio_capture();
+    */
+
     // start DoS attack on seperate task
     /*
     uint8_t AP_mac[6] = {0x34, 0x2c, 0xc4, 0xad, 0xb2, 0xd5};